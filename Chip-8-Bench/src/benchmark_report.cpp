@@ -0,0 +1,117 @@
+#include "benchmark_report.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+	// Value of "key": in a line written by write_report
+	bool find_field(const std::string& line, const std::string& key, std::string& value)
+	{
+		std::string pattern = "\"" + key + "\": ";
+		size_t start = line.find(pattern);
+		if (start == std::string::npos) {
+			return false;
+		}
+		start += pattern.size();
+
+		if (line[start] == '"') {
+			size_t end = line.find('"', start + 1);
+			if (end == std::string::npos) {
+				return false;
+			}
+			value = line.substr(start + 1, end - start - 1);
+		}
+		else {
+			size_t end = line.find_first_of(",}", start);
+			value = line.substr(start, end - start);
+		}
+
+		return true;
+	}
+}
+
+void write_report(std::ostream& out, const std::vector<BenchmarkResult>& results)
+{
+	out << "{" << std::endl;
+	out << "  \"benchmarks\": [" << std::endl;
+	for (size_t idx = 0; idx < results.size(); ++idx) {
+		const BenchmarkResult& result = results[idx];
+		out << "    { \"name\": \"" << result.name << "\", \"value\": " << std::setprecision(6) << result.value
+			<< ", \"unit\": \"" << result.unit << "\" }" << (idx + 1 < results.size() ? "," : "") << std::endl;
+	}
+	out << "  ]" << std::endl;
+	out << "}" << std::endl;
+}
+
+int read_report(const std::string& path, std::vector<BenchmarkResult>& results)
+{
+	std::ifstream report_file(path);
+	if (report_file.fail()) {
+		return EXIT_FAILURE;
+	}
+
+	std::string line;
+	while (std::getline(report_file, line)) {
+		BenchmarkResult result;
+		std::string value;
+		if (find_field(line, "name", result.name) && find_field(line, "value", value) && find_field(line, "unit", result.unit)) {
+			result.value = std::strtod(value.c_str(), nullptr);
+			results.push_back(result);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int compare_reports(const std::vector<BenchmarkResult>& baseline, const std::vector<BenchmarkResult>& current, double threshold_percent, std::ostream& out)
+{
+	int failures = 0;
+	auto same_benchmark = [](const BenchmarkResult& lhs, const BenchmarkResult& rhs) {
+		return lhs.name == rhs.name && lhs.unit == rhs.unit;
+	};
+
+	out << std::fixed << std::setprecision(2);
+	for (const BenchmarkResult& result : current) {
+		auto reference = std::find_if(baseline.begin(), baseline.end(), [&](const BenchmarkResult& candidate) {
+			return same_benchmark(candidate, result);
+		});
+		if (reference == baseline.end()) {
+			out << "NEW        " << std::left << std::setw(32) << result.name << std::right << std::setw(12) << "" << "    "
+				<< std::setw(12) << result.value << " " << std::setw(5) << result.unit << " (not in baseline)" << std::endl;
+			continue;
+		}
+		if (reference->value <= 0.0) {
+			continue;
+		}
+
+		// Positive change is always a slowdown, whatever the unit
+		double change = (result.value - reference->value) / reference->value * 100.0;
+		if (result.unit == "MIPS" || result.unit == "IPC") {
+			change = -change;
+		}
+
+		bool regressed = change > threshold_percent;
+		failures += regressed;
+
+		out << (regressed ? "REGRESSION " : "           ") << std::left << std::setw(32) << result.name << std::right
+			<< std::setw(12) << reference->value << " -> " << std::setw(12) << result.value << " " << std::setw(5) << result.unit
+			<< " (" << (change > 0.0 ? "+" : "") << change << "%)" << std::endl;
+	}
+
+	// A benchmark that disappeared, renamed or no longer run, would otherwise let its regression through unnoticed
+	for (const BenchmarkResult& reference : baseline) {
+		bool found = std::any_of(current.begin(), current.end(), [&](const BenchmarkResult& candidate) {
+			return same_benchmark(candidate, reference);
+		});
+		if (!found) {
+			out << "MISSING    " << std::left << std::setw(32) << reference.name << std::right << std::setw(12) << reference.value
+				<< "    " << std::setw(12) << "" << " " << std::setw(5) << reference.unit << " (not in current report)" << std::endl;
+			++failures;
+		}
+	}
+	out << std::defaultfloat;
+
+	return failures;
+}
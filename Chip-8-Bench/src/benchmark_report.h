@@ -0,0 +1,21 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BenchmarkResult
+{
+	std::string name;
+	double value;
+	std::string unit; // "MIPS" and "IPC" are better when higher, every other unit ("ns/op", "cycles/op"...) when lower
+};
+
+// JSON report, one benchmark object per line so that reports diff well
+void write_report(std::ostream& out, const std::vector<BenchmarkResult>& results);
+
+// Only reads reports written by write_report
+int read_report(const std::string& path, std::vector<BenchmarkResult>& results);
+
+// Print every benchmark present in both reports and the ones found in a single report. Returns how many regressed by
+// more than threshold_percent plus how many of the baseline are missing from the current report
+int compare_reports(const std::vector<BenchmarkResult>& baseline, const std::vector<BenchmarkResult>& current, double threshold_percent, std::ostream& out);
@@ -0,0 +1,198 @@
+#include "handler_benchmark.h"
+#include "emulator.h"
+#include "perf_counters.h"
+#include "workload_generator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	const int REPETITIONS = 5;
+
+	// Keeps the results observable so the timed loops cannot be optimized away
+	volatile uint8_t sink;
+	const void* volatile escaped;
+
+	// Compiler barrier: whatever the object references is assumed read and written there. With whole program
+	// optimization the handlers are inlined, their stores would otherwise be hoisted out of the timed loop
+	template <typename T>
+	inline void clobber(T& object)
+	{
+#ifdef _MSC_VER
+		escaped = &object;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r"(&object) : "memory");
+#endif
+	}
+
+	// Best of several repetitions, the minimum is the least disturbed by the rest of the system
+	template <typename Body>
+	double time_per_call(uint64_t iterations, Body body)
+	{
+		double best = std::numeric_limits<double>::max();
+		for (int repetition = 0; repetition < REPETITIONS; ++repetition) {
+			auto start_time = std::chrono::steady_clock::now();
+			for (uint64_t iteration = 0; iteration < iterations; ++iteration) {
+				body();
+				clobber(body);
+			}
+			std::chrono::duration<double, std::nano> elapsed_time = std::chrono::steady_clock::now() - start_time;
+			best = std::min(best, elapsed_time.count() / iterations);
+		}
+		return best;
+	}
+}
+
+void HandlerBenchmark::run_handlers(uint64_t iterations, std::vector<BenchmarkResult>& results)
+{
+	// Jump to itself, the program is never executed but init needs one
+	const uint8_t program[] = { 0x12, 0x00 };
+
+	Emulator emulator;
+	emulator.init(program, sizeof(program));
+	emulator.seed(1);
+	emulator.v[1] = 0x12;
+	emulator.v[2] = 0x34;
+
+	auto add = [&](const char* name, auto body) {
+		results.push_back({ name, time_per_call(iterations, body), "ns/op" });
+	};
+
+	add("cls", [&] { emulator.cls(); });
+	add("drw_vx_vy_nibble.font", [&] { emulator.i = 0; emulator.drw_vx_vy_nibble(1, 2, 5); });
+	add("drw_vx_vy_nibble.15_rows", [&] { emulator.i = 0x200; emulator.drw_vx_vy_nibble(1, 2, 15); });
+	add("drw_vx_vy_nibble.wrapped", [&] { emulator.i = 0; emulator.v[3] = 60; emulator.v[4] = 30; emulator.drw_vx_vy_nibble(3, 4, 5); });
+	add("call_addr+ret", [&] { emulator.call_addr(0x300); emulator.ret(); });
+	add("ld_vx_byte", [&] { emulator.ld_vx_byte(3, 0x56); });
+	add("add_vx_byte", [&] { emulator.add_vx_byte(3, 0x01); });
+	add("ld_vx_vy", [&] { emulator.ld_vx_vy(3, 1); });
+	add("or_vx_vy", [&] { emulator.or_vx_vy(3, 2); });
+	add("and_vx_vy", [&] { emulator.and_vx_vy(3, 2); });
+	add("xor_vx_vy", [&] { emulator.xor_vx_vy(3, 2); });
+	add("add_vx_vy", [&] { emulator.add_vx_vy(3, 2); });
+	add("sub_vx_vy", [&] { emulator.sub_vx_vy(3, 2); });
+	add("shr_vx_vy", [&] { emulator.shr_vx_vy(3, 2); });
+	add("subn_vx_vy", [&] { emulator.subn_vx_vy(3, 2); });
+	add("shl_vx_vy", [&] { emulator.shl_vx_vy(3, 2); });
+	add("rnd_vx_byte", [&] { emulator.rnd_vx_byte(3, 0xFF); });
+	add("ld_b_vx", [&] { emulator.i = 0x300; emulator.ld_b_vx(1); });
+	add("ld_i_vx", [&] { emulator.i = 0x300; emulator.ld_i_vx(0xF); });
+	add("ld_vx_i", [&] { emulator.i = 0x300; emulator.ld_vx_i(0xE); });
+
+	// Same work as ld_vx_byte, the difference is the cost of decoding and dispatching one opcode
+	double decode_time = time_per_call(iterations, [&] { emulator.decode_opcode(0x6356); });
+	double direct_time = time_per_call(iterations, [&] { emulator.ld_vx_byte(3, 0x56); });
+	results.push_back({ "decode_opcode.6xkk", decode_time, "ns/op" });
+	results.push_back({ "decode_opcode.dispatch", std::max(0.0, decode_time - direct_time), "ns/op" });
+
+	// Run-ahead takes and restores one snapshot every presented frame
+	MachineState snapshot;
+	add("save_state", [&] { snapshot = emulator.save_state(); });
+	add("rewind_state", [&] { emulator.rewind_state(snapshot); });
+
+	sink = emulator.v[0xF] ^ emulator.v[3] ^ emulator.display[0];
+}
+
+int HandlerBenchmark::run_program(const std::string& program_path, uint64_t cycles, std::vector<BenchmarkResult>& results)
+{
+	Emulator pristine;
+	if (pristine.init(program_path) == EXIT_FAILURE) {
+		std::cerr << "Failed to initialize emulator with " << program_path << std::endl;
+		return EXIT_FAILURE;
+	}
+	pristine.seed(1);
+
+	measure_backends("program." + std::filesystem::path(program_path).stem().string(), pristine, cycles, results);
+	return EXIT_SUCCESS;
+}
+
+void HandlerBenchmark::run_workloads(uint64_t cycles, std::vector<BenchmarkResult>& results)
+{
+	for (int workload = 0; workload < WORKLOAD_COUNT; ++workload) {
+		WorkloadOptions options;
+		options.mix[workload] = 1;
+		std::vector<uint8_t> program = generate_workload(options);
+
+		Emulator pristine;
+		pristine.init(program.data(), program.size());
+		pristine.seed(1);
+
+		measure_backends(std::string("workload.") + workload_name(static_cast<Workload>(workload)), pristine, cycles, results);
+	}
+}
+
+void HandlerBenchmark::measure_backends(const std::string& name, const MachineState& pristine, uint64_t cycles, std::vector<BenchmarkResult>& results)
+{
+	for (int backend = 0; backend < BACKEND_COUNT; ++backend) {
+		measure_throughput(name + "." + BACKEND_NAMES[backend], pristine, BACKEND_NAMES[backend], cycles, results);
+	}
+}
+
+// Whole execution backend in MIPS, the program is restarted whenever it halts, waits for a key or fails. The host
+// counters, when available, are reported per emulated instruction: dispatch mispredictions show up as branch misses
+void HandlerBenchmark::measure_throughput(const std::string& name, const MachineState& pristine, const char* backend_name, uint64_t cycles, std::vector<BenchmarkResult>& results)
+{
+	const uint64_t CHUNK_CYCLES = 1024;
+
+	Emulator emulator;
+	emulator.set_backend(make_backend(backend_name));
+	emulator.load_state(pristine);
+	uint64_t executed = 0;
+
+	PerfCounters counters;
+	auto start_time = std::chrono::steady_clock::now();
+	counters.start();
+
+	while (executed < cycles) {
+		uint64_t start_cycle = emulator.cycle_count;
+		bool running = true;
+		try {
+			running = emulator.run_cycles(std::min(CHUNK_CYCLES, cycles - executed));
+		}
+		catch (const std::exception&) {
+			running = false;
+			++executed; // the faulting instruction is not counted in cycle_count
+		}
+		executed += emulator.cycle_count - start_cycle;
+
+		if (!running || emulator.idle()) {
+			emulator.load_state(pristine);
+		}
+	}
+
+	counters.stop();
+	std::chrono::duration<double> elapsed_time = std::chrono::steady_clock::now() - start_time;
+	sink = emulator.v[0];
+
+	results.push_back({ name, executed / elapsed_time.count() / 1e6, "MIPS" });
+
+	double counts[PerfCounters::COUNTER_COUNT];
+	bool available[PerfCounters::COUNTER_COUNT];
+	for (int counter = 0; counter < PerfCounters::COUNTER_COUNT; ++counter) {
+		available[counter] = counters.read(static_cast<PerfCounters::Counter>(counter), counts[counter]);
+	}
+
+	if (available[PerfCounters::CYCLES]) {
+		results.push_back({ name + ".host_cycles", counts[PerfCounters::CYCLES] / executed, "cycles/op" });
+	}
+	if (available[PerfCounters::INSTRUCTIONS]) {
+		results.push_back({ name + ".host_instructions", counts[PerfCounters::INSTRUCTIONS] / executed, "instr/op" });
+	}
+	if (available[PerfCounters::CYCLES] && available[PerfCounters::INSTRUCTIONS] && counts[PerfCounters::CYCLES] > 0.0) {
+		results.push_back({ name + ".ipc", counts[PerfCounters::INSTRUCTIONS] / counts[PerfCounters::CYCLES], "IPC" });
+	}
+	if (available[PerfCounters::BRANCH_MISSES]) {
+		results.push_back({ name + ".branch_misses", counts[PerfCounters::BRANCH_MISSES] / executed, "misses/op" });
+	}
+	if (available[PerfCounters::L1D_MISSES]) {
+		results.push_back({ name + ".l1d_misses", counts[PerfCounters::L1D_MISSES] / executed, "misses/op" });
+	}
+}
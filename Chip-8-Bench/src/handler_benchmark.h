@@ -0,0 +1,24 @@
+#pragma once
+#include "benchmark_report.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct MachineState;
+
+// Friend of Emulator so that each instruction handler can be timed in isolation, without fetch and dispatch
+class HandlerBenchmark
+{
+public:
+	static void run_handlers(uint64_t iterations, std::vector<BenchmarkResult>& results);
+
+	// Throughput of every execution backend on a real program
+	static int run_program(const std::string& program_path, uint64_t cycles, std::vector<BenchmarkResult>& results);
+
+	// One generated program per workload kind, each stressing a single execution path
+	static void run_workloads(uint64_t cycles, std::vector<BenchmarkResult>& results);
+
+private:
+	static void measure_backends(const std::string& name, const MachineState& pristine, uint64_t cycles, std::vector<BenchmarkResult>& results);
+	static void measure_throughput(const std::string& name, const MachineState& pristine, const char* backend_name, uint64_t cycles, std::vector<BenchmarkResult>& results);
+};
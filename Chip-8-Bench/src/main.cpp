@@ -0,0 +1,129 @@
+#include "benchmark_report.h"
+#include "handler_benchmark.h"
+#include "perf_counters.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	void print_usage()
+	{
+		std::cerr << "Usage: Chip-8-Bench [program...] [--workloads] [--iterations N] [--cycles N] [--out FILE]" << std::endl;
+		std::cerr << "       Chip-8-Bench --compare <baseline.json> <current.json> [--threshold PERCENT]" << std::endl;
+	}
+
+	// Exit code is the CI verdict: failure when any benchmark regressed beyond the threshold
+	int compare(int argc, char* argv[])
+	{
+		std::vector<std::string> paths;
+		double threshold = 5.0;
+
+		for (int arg_idx = 0; arg_idx < argc; ++arg_idx) {
+			std::string arg = argv[arg_idx];
+
+			if (arg == "--threshold" && arg_idx + 1 < argc) {
+				threshold = std::strtod(argv[++arg_idx], nullptr);
+			}
+			else if (arg.rfind("--", 0) != 0) {
+				paths.push_back(arg);
+			}
+			else {
+				paths.clear();
+				break;
+			}
+		}
+
+		if (paths.size() != 2) {
+			print_usage();
+			return EXIT_FAILURE;
+		}
+
+		std::vector<BenchmarkResult> baseline;
+		std::vector<BenchmarkResult> current;
+		for (size_t idx = 0; idx < paths.size(); ++idx) {
+			if (read_report(paths[idx], idx == 0 ? baseline : current) == EXIT_FAILURE) {
+				std::cerr << "Error reading benchmark report: " << paths[idx] << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+
+		int failures = compare_reports(baseline, current, threshold, std::cout);
+		std::cout << failures << " regression(s) above " << threshold << "% or benchmark(s) missing" << std::endl;
+		return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && std::string(argv[1]) == "--compare") {
+		return compare(argc - 2, argv + 2);
+	}
+
+	std::vector<std::string> program_paths;
+	uint64_t iterations = 1000000;
+	uint64_t cycles = 50000000;
+	std::string output_path;
+	bool workloads = false;
+
+	for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+		std::string arg = argv[arg_idx];
+		bool has_value = arg_idx + 1 < argc;
+
+		if (arg == "--iterations" && has_value) {
+			iterations = std::strtoull(argv[++arg_idx], nullptr, 0);
+		}
+		else if (arg == "--cycles" && has_value) {
+			cycles = std::strtoull(argv[++arg_idx], nullptr, 0);
+		}
+		else if (arg == "--workloads") {
+			workloads = true;
+		}
+		else if (arg == "--out" && has_value) {
+			output_path = argv[++arg_idx];
+		}
+		else if (arg.rfind("--", 0) != 0) {
+			program_paths.push_back(arg);
+		}
+		else {
+			print_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (iterations == 0 || cycles == 0) {
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	if ((workloads || !program_paths.empty()) && !PerfCounters().available(PerfCounters::CYCLES)) {
+		std::cerr << "Host performance counters unavailable, reporting MIPS only" << std::endl;
+	}
+
+	std::vector<BenchmarkResult> results;
+	HandlerBenchmark::run_handlers(iterations, results);
+	if (workloads) {
+		HandlerBenchmark::run_workloads(cycles, results);
+	}
+	for (const std::string& program_path : program_paths) {
+		if (HandlerBenchmark::run_program(program_path, cycles, results) == EXIT_FAILURE) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (output_path.empty()) {
+		write_report(std::cout, results);
+		return EXIT_SUCCESS;
+	}
+
+	std::ofstream output_file(output_path);
+	write_report(output_file, results);
+	if (output_file.fail()) {
+		std::cerr << "Error writing benchmark report: " << output_path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
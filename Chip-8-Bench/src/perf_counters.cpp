@@ -0,0 +1,114 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* const PerfCounters::COUNTER_NAMES[COUNTER_COUNT] = { "host_cycles", "host_instructions", "branch_misses", "l1d_misses" };
+
+#ifdef __linux__
+namespace
+{
+	int open_counter(uint32_t type, uint64_t config)
+	{
+		perf_event_attr attributes;
+		std::memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = type;
+		attributes.config = config;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		// This thread on any CPU
+		return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+	}
+}
+
+PerfCounters::PerfCounters()
+{
+	fds[CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	fds[INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	fds[BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	fds[L1D_MISSES] = open_counter(PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+PerfCounters::~PerfCounters()
+{
+	for (int fd : fds) {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+}
+
+void PerfCounters::start()
+{
+	for (int fd : fds) {
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+void PerfCounters::stop()
+{
+	for (int fd : fds) {
+		if (fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+}
+
+bool PerfCounters::read(Counter counter, double& value) const
+{
+	if (fds[counter] < 0) {
+		return false;
+	}
+
+	// value, time enabled, time running
+	uint64_t data[3];
+	if (::read(fds[counter], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+		return false;
+	}
+
+	value = static_cast<double>(data[0]) * data[1] / data[2];
+	return true;
+}
+#else
+PerfCounters::PerfCounters()
+{
+	for (int& fd : fds) {
+		fd = -1;
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+void PerfCounters::start()
+{
+}
+
+void PerfCounters::stop()
+{
+}
+
+bool PerfCounters::read(Counter counter, double& value) const
+{
+	return false;
+}
+#endif
+
+bool PerfCounters::available(Counter counter) const
+{
+	return fds[counter] >= 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+// Host hardware counters around a region of code, with Linux perf_event_open. Elsewhere, or when the kernel refuses
+// them (containers, perf_event_paranoid), the counters are simply unavailable and nothing is reported.
+class PerfCounters
+{
+public:
+	enum Counter {
+		CYCLES,
+		INSTRUCTIONS,
+		BRANCH_MISSES,
+		L1D_MISSES,
+		COUNTER_COUNT,
+	};
+
+	static const char* const COUNTER_NAMES[COUNTER_COUNT];
+
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	bool available(Counter counter) const;
+
+	// Counts are reset by start and accumulate until stop
+	void start();
+	void stop();
+
+	// Scaled when the kernel multiplexed the counter, false when it is unavailable or never ran
+	bool read(Counter counter, double& value) const;
+
+private:
+	int fds[COUNTER_COUNT];
+};
@@ -0,0 +1,214 @@
+#include "cached_backend.h"
+#include "emulator.h"
+#include <stdexcept>
+
+CachedBackend::CachedBackend() :
+	cache(Emulator::MEMORY_SIZE, DecodedInstruction{ nullptr, 0, 0, 0 })
+{
+}
+
+const char* CachedBackend::name() const
+{
+	return "cached";
+}
+
+std::unique_ptr<ExecutionBackend> CachedBackend::clone() const
+{
+	return std::make_unique<CachedBackend>(*this);
+}
+
+bool CachedBackend::run_cycles(Emulator& emulator, uint64_t cycles)
+{
+	return execute<false>(emulator, cycles);
+}
+
+bool CachedBackend::run_frame(Emulator& emulator, uint64_t cycles)
+{
+	return execute<true>(emulator, cycles);
+}
+
+void CachedBackend::invalidate(uint16_t address, uint16_t size)
+{
+	// The instruction starting one byte before the range overlaps it too
+	for (int idx = -1; idx < size; ++idx) {
+		cache[(address + idx) & Emulator::ADDRESS_MASK].handler = nullptr;
+	}
+}
+
+void CachedBackend::flush()
+{
+	for (DecodedInstruction& instruction : cache) {
+		instruction.handler = nullptr;
+	}
+}
+
+// Same semantics as Emulator::cycle, the lockstep checker compares both
+template <bool STOP_WHEN_BLOCKED>
+bool CachedBackend::execute(Emulator& emulator, uint64_t cycles)
+{
+	for (uint64_t cycle = 0; cycle < cycles; ++cycle) {
+		if (emulator.input_head != emulator.input_tail) {
+			emulator.apply_inputs();
+		}
+
+		uint16_t address = emulator.pc & Emulator::ADDRESS_MASK;
+		const DecodedInstruction& instruction = cache[address].handler ? cache[address] : decode(emulator, address);
+		emulator.pc += 2;
+
+		emulator.status = Emulator::RUNNING;
+		instruction.handler(emulator, instruction);
+		++emulator.cycle_count;
+
+		if (emulator.fetch_opcode() == 0) {
+			return false;
+		}
+
+		if (STOP_WHEN_BLOCKED && emulator.blocked()) {
+			break;
+		}
+	}
+
+	return true;
+}
+
+const CachedBackend::DecodedInstruction& CachedBackend::decode(const Emulator& emulator, uint16_t address)
+{
+	uint16_t opcode = emulator.memory[address] << 8 | emulator.memory[(address + 1) & Emulator::ADDRESS_MASK];
+	uint16_t x = Emulator::extract(opcode, BitMask::X);
+	uint16_t y = Emulator::extract(opcode, BitMask::Y);
+
+	Handler handler = [](Emulator&, const DecodedInstruction&) { throw std::invalid_argument("unknown opcode"); };
+	uint16_t operand = 0;
+
+	switch (Emulator::extract(opcode, BitMask::OP)) {
+	case 0x0:
+		if (opcode == 0x00E0) {
+			handler = [](Emulator& e, const DecodedInstruction&) { e.cls(); };
+		}
+		else if (opcode == 0x00EE) {
+			handler = [](Emulator& e, const DecodedInstruction&) { e.ret(); };
+		}
+		break;
+	case 0x1:
+		operand = Emulator::extract(opcode, BitMask::NNN);
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.jp_addr(d.operand); };
+		break;
+	case 0x2:
+		operand = Emulator::extract(opcode, BitMask::NNN);
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.call_addr(d.operand); };
+		break;
+	case 0x3:
+		operand = Emulator::extract(opcode, BitMask::KK);
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.se_vx_byte(d.x, d.operand); };
+		break;
+	case 0x4:
+		operand = Emulator::extract(opcode, BitMask::KK);
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.sne_vx_byte(d.x, d.operand); };
+		break;
+	case 0x5:
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.se_vx_vy(d.x, d.y); };
+		break;
+	case 0x6:
+		operand = Emulator::extract(opcode, BitMask::KK);
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_vx_byte(d.x, d.operand); };
+		break;
+	case 0x7:
+		operand = Emulator::extract(opcode, BitMask::KK);
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.add_vx_byte(d.x, d.operand); };
+		break;
+	case 0x8:
+		switch (Emulator::extract(opcode, BitMask::N)) {
+		case 0x0:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_vx_vy(d.x, d.y); };
+			break;
+		case 0x1:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.or_vx_vy(d.x, d.y); };
+			break;
+		case 0x2:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.and_vx_vy(d.x, d.y); };
+			break;
+		case 0x3:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.xor_vx_vy(d.x, d.y); };
+			break;
+		case 0x4:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.add_vx_vy(d.x, d.y); };
+			break;
+		case 0x5:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.sub_vx_vy(d.x, d.y); };
+			break;
+		case 0x6:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.shr_vx_vy(d.x, d.y); };
+			break;
+		case 0x7:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.subn_vx_vy(d.x, d.y); };
+			break;
+		case 0xE:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.shl_vx_vy(d.x, d.y); };
+			break;
+		}
+		break;
+	case 0x9:
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.sne_vx_vy(d.x, d.y); };
+		break;
+	case 0xA:
+		operand = Emulator::extract(opcode, BitMask::NNN);
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_i_addr(d.operand); };
+		break;
+	case 0xB:
+		operand = Emulator::extract(opcode, BitMask::NNN);
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.jp_v0_addr(d.operand); };
+		break;
+	case 0xC:
+		operand = Emulator::extract(opcode, BitMask::KK);
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.rnd_vx_byte(d.x, d.operand); };
+		break;
+	case 0xD:
+		operand = Emulator::extract(opcode, BitMask::N);
+		handler = [](Emulator& e, const DecodedInstruction& d) { e.drw_vx_vy_nibble(d.x, d.y, d.operand); };
+		break;
+	case 0xE:
+		switch (Emulator::extract(opcode, BitMask::KK)) {
+		case 0x9E:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.skp_vx(d.x); };
+			break;
+		case 0xA1:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.sknp_vx(d.x); };
+			break;
+		}
+		break;
+	case 0xF:
+		switch (Emulator::extract(opcode, BitMask::KK)) {
+		case 0x07:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_vx_dt(d.x); };
+			break;
+		case 0x0A:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_vx_k(d.x); };
+			break;
+		case 0x15:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_dt_vx(d.x); };
+			break;
+		case 0x18:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_st_vx(d.x); };
+			break;
+		case 0x1E:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.add_i_vx(d.x); };
+			break;
+		case 0x29:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_f_vx(d.x); };
+			break;
+		case 0x33:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_b_vx(d.x); };
+			break;
+		case 0x55:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_i_vx(d.x); };
+			break;
+		case 0x65:
+			handler = [](Emulator& e, const DecodedInstruction& d) { e.ld_vx_i(d.x); };
+			break;
+		}
+		break;
+	}
+
+	cache[address] = { handler, x, y, operand };
+	return cache[address];
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "execution_backend.h"
+#include <vector>
+
+// Throughput engine: every address is decoded once into a handler and its operands, then dispatched without decoding
+// again. Fx33 and Fx55 invalidate the entries they overwrite, so self-modifying programs stay correct.
+class CachedBackend : public ExecutionBackend
+{
+public:
+	CachedBackend();
+
+	const char* name() const override;
+	std::unique_ptr<ExecutionBackend> clone() const override;
+	bool run_cycles(Emulator& emulator, uint64_t cycles) override;
+	bool run_frame(Emulator& emulator, uint64_t cycles) override;
+	void invalidate(uint16_t address, uint16_t size) override;
+	void flush() override;
+
+private:
+	struct DecodedInstruction;
+	typedef void (*Handler)(Emulator& emulator, const DecodedInstruction& instruction);
+
+	struct DecodedInstruction
+	{
+		Handler handler;			// nullptr until the address is executed
+		uint16_t x;
+		uint16_t y;
+		uint16_t operand;			// nnn, kk or n depending on the handler
+	};
+
+	std::vector<DecodedInstruction> cache; // indexed by address
+
+	const DecodedInstruction& decode(const Emulator& emulator, uint16_t address);
+
+	template <bool STOP_WHEN_BLOCKED>
+	bool execute(Emulator& emulator, uint64_t cycles);
+};
@@ -0,0 +1,116 @@
+#include "call_profiler.h"
+#include "disassembler.h"
+#include "machine_state.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	std::string function_name(const std::vector<uint16_t>& path, size_t idx)
+	{
+		if (idx == 0) {
+			return "main";
+		}
+
+		std::ostringstream name;
+		name << "sub_" << std::uppercase << std::hex << std::setw(3) << std::setfill('0') << path[idx];
+		return name.str();
+	}
+}
+
+CallProfiler::CallProfiler(uint16_t entry_point) :
+	nodes{ { entry_point, -1, 1, 0 } },
+	current(0)
+{
+}
+
+void CallProfiler::set_cost_model(const std::vector<uint32_t>& model)
+{
+	cost_model = model;
+}
+
+void CallProfiler::on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode)
+{
+	// CALL is paid by the caller and RET by the subroutine
+	int kind = instruction_kind(opcode);
+	nodes[current].exclusive += cost_model.empty() || kind < 0 ? 1 : cost_model[kind];
+
+	if ((opcode >> 12) == 0x2) {
+		uint16_t function = opcode & MachineState::ADDRESS_MASK;
+		uint32_t key = static_cast<uint32_t>(current) << 12 | function;
+		auto child = children.find(key);
+		if (child == children.end()) {
+			child = children.emplace(key, static_cast<int>(nodes.size())).first;
+			nodes.push_back({ function, current, 0, 0 });
+		}
+		current = child->second;
+		++nodes[current].calls;
+	}
+	else if (opcode == 0x00EE && nodes[current].parent >= 0) {
+		current = nodes[current].parent;
+	}
+}
+
+std::vector<uint16_t> CallProfiler::path_of(int node) const
+{
+	std::vector<uint16_t> path;
+	for (; node >= 0; node = nodes[node].parent) {
+		path.push_back(nodes[node].function);
+	}
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+std::vector<CallProfiler::CallPath> CallProfiler::call_paths() const
+{
+	// Children are always created after their parent, so one backward pass accumulates whole subtrees
+	std::vector<uint64_t> inclusive(nodes.size());
+	for (size_t idx = nodes.size(); idx-- > 0;) {
+		inclusive[idx] += nodes[idx].exclusive;
+		if (nodes[idx].parent >= 0) {
+			inclusive[nodes[idx].parent] += inclusive[idx];
+		}
+	}
+
+	std::vector<CallPath> paths;
+	for (size_t idx = 0; idx < nodes.size(); ++idx) {
+		paths.push_back({ path_of(static_cast<int>(idx)), nodes[idx].calls, nodes[idx].exclusive, inclusive[idx] });
+	}
+
+	std::stable_sort(paths.begin(), paths.end(), [](const CallPath& a, const CallPath& b) {
+		return a.inclusive > b.inclusive;
+	});
+	return paths;
+}
+
+void CallProfiler::write_folded(std::ostream& out) const
+{
+	for (size_t idx = 0; idx < nodes.size(); ++idx) {
+		if (!nodes[idx].exclusive) {
+			continue;
+		}
+
+		std::vector<uint16_t> path = path_of(static_cast<int>(idx));
+		for (size_t depth = 0; depth < path.size(); ++depth) {
+			out << (depth ? ";" : "") << function_name(path, depth);
+		}
+		out << " " << nodes[idx].exclusive << std::endl;
+	}
+}
+
+void CallProfiler::write_report(std::ostream& out, size_t limit) const
+{
+	std::vector<CallPath> paths = call_paths();
+
+	out << "     Calls     Inclusive     Exclusive  Call path" << std::endl;
+	for (size_t idx = 0; idx < paths.size() && (!limit || idx < limit); ++idx) {
+		const CallPath& path = paths[idx];
+		out << std::setw(10) << path.calls << std::setw(14) << path.inclusive << std::setw(14) << path.exclusive << "  ";
+		for (size_t depth = 0; depth < path.functions.size(); ++depth) {
+			out << (depth ? " > " : "") << function_name(path.functions, depth);
+		}
+		out << std::endl;
+	}
+}
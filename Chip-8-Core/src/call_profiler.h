@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "execution_observer.h"
+
+// Cost of every emulated call path, from a shadow of the call stack maintained by CALL and RET. Exclusive cost is
+// spent in the subroutine itself, inclusive cost adds the subroutines it called. Costs follow the same model as
+// PcProfiler, 1 per instruction without one.
+class CallProfiler : public ExecutionObserver
+{
+public:
+	struct CallPath
+	{
+		std::vector<uint16_t> functions;	// entry point first, then each called subroutine
+		uint64_t calls;
+		uint64_t exclusive;
+		uint64_t inclusive;
+	};
+
+	explicit CallProfiler(uint16_t entry_point = 0x200);
+
+	// Cost of each instruction handler indexed like INSTRUCTION_NAMES, empty for no model
+	void set_cost_model(const std::vector<uint32_t>& model);
+
+	void on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode) override;
+
+	std::vector<CallPath> call_paths() const; // most expensive inclusive first
+
+	// One "main;sub_2A0;sub_31C <exclusive cost>" line per path, the input of flame graph tools
+	void write_folded(std::ostream& out) const;
+	void write_report(std::ostream& out, size_t limit) const;
+
+private:
+	struct Node
+	{
+		uint16_t function;
+		int parent;					// -1 for the entry point
+		uint64_t calls;
+		uint64_t exclusive;
+	};
+
+	std::vector<Node> nodes;		// call tree, the entry point at index 0
+	std::unordered_map<uint32_t, int> children; // parent index << 12 | function to node index
+	std::vector<uint32_t> cost_model;
+	int current;
+
+	std::vector<uint16_t> path_of(int node) const;
+};
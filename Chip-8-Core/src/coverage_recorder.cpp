@@ -0,0 +1,92 @@
+#include "coverage_recorder.h"
+#include "disassembler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+	void write_ranges(std::ostream& out, const char* name, const std::bitset<MachineState::MEMORY_SIZE>& map)
+	{
+		out << name << std::uppercase << std::hex;
+		for (int start = 0; start < MachineState::MEMORY_SIZE;) {
+			if (!map[start]) {
+				++start;
+				continue;
+			}
+
+			int stop = start;
+			while (stop < MachineState::MEMORY_SIZE && map[stop]) {
+				++stop;
+			}
+			out << " " << std::setw(3) << std::setfill('0') << start << "-" << std::setw(3) << std::setfill('0') << (stop - 1);
+			start = stop;
+		}
+		out << std::dec << std::endl;
+	}
+}
+
+CoverageRecorder::CoverageRecorder() :
+	instruction_counts(INSTRUCTION_KIND_COUNT, 0)
+{
+}
+
+void CoverageRecorder::on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode)
+{
+	executed.set(address);
+	executed.set((address + 1) & MachineState::ADDRESS_MASK);
+
+	int kind = instruction_kind(opcode);
+	if (kind >= 0) {
+		++instruction_counts[kind];
+	}
+}
+
+void CoverageRecorder::on_memory_read(uint16_t address, uint16_t size)
+{
+	for (uint16_t offset = 0; offset < size; ++offset) {
+		read.set((address + offset) & MachineState::ADDRESS_MASK);
+	}
+}
+
+void CoverageRecorder::on_memory_write(uint16_t address, uint16_t size)
+{
+	for (uint16_t offset = 0; offset < size; ++offset) {
+		written.set((address + offset) & MachineState::ADDRESS_MASK);
+	}
+}
+
+void CoverageRecorder::merge(const CoverageRecorder& other)
+{
+	executed |= other.executed;
+	read |= other.read;
+	written |= other.written;
+	for (int kind = 0; kind < INSTRUCTION_KIND_COUNT; ++kind) {
+		instruction_counts[kind] += other.instruction_counts[kind];
+	}
+}
+
+void CoverageRecorder::reset()
+{
+	executed.reset();
+	read.reset();
+	written.reset();
+	std::fill(instruction_counts.begin(), instruction_counts.end(), 0);
+}
+
+int CoverageRecorder::save(const std::string& path) const
+{
+	std::ofstream output_file(path);
+
+	write_ranges(output_file, "executed", executed);
+	write_ranges(output_file, "read", read);
+	write_ranges(output_file, "written", written);
+	for (int kind = 0; kind < INSTRUCTION_KIND_COUNT; ++kind) {
+		if (instruction_counts[kind]) {
+			output_file << "count " << INSTRUCTION_NAMES[kind] << " " << instruction_counts[kind] << std::endl;
+		}
+	}
+
+	return output_file.fail() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "execution_observer.h"
+#include "machine_state.h"
+
+// Execution guided code and data map: which bytes were executed, read or written through I, and how many times each
+// instruction handler ran. Unlike the static analysis it follows computed jumps, and runs can be merged over a corpus.
+class CoverageRecorder : public ExecutionObserver
+{
+public:
+	std::bitset<MachineState::MEMORY_SIZE> executed;	// both bytes of every executed instruction
+	std::bitset<MachineState::MEMORY_SIZE> read;
+	std::bitset<MachineState::MEMORY_SIZE> written;
+	std::vector<uint64_t> instruction_counts;			// indexed like INSTRUCTION_NAMES
+
+	CoverageRecorder();
+
+	void on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode) override;
+	void on_memory_read(uint16_t address, uint16_t size) override;
+	void on_memory_write(uint16_t address, uint16_t size) override;
+
+	void merge(const CoverageRecorder& other);
+	void reset();
+
+	// Text format, the address ranges of each map then the count of every handler that ran:
+	//   executed 200-2A3 2B0-2B1
+	//   count drw_vx_vy_nibble 1234
+	int save(const std::string& path) const;
+};
@@ -0,0 +1,665 @@
+#include "debugger.h"
+#include "emulator.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	enum ConditionOp : uint8_t {
+		PUSH,			// followed by the 16-bit value, high byte first
+		PUSH_V,			// followed by the register number
+		PUSH_I,
+		PUSH_DT,
+		PUSH_ST,
+		PUSH_PC,
+		PUSH_SP,
+		LOAD,			// replaces the address on top of the stack by the memory byte at that address
+		NOT,
+		ADD,
+		SUB,
+		BIT_AND,
+		EQUAL,
+		NOT_EQUAL,
+		LESS,
+		LESS_EQUAL,
+		GREATER,
+		GREATER_EQUAL,
+		AND,
+		OR,
+	};
+
+	const int STACK_LIMIT = 16;
+
+	// Decimal, 0x2A4 or #2A4, up to 0xFFFF
+	bool parse_number(const std::string& text, size_t& position, uint32_t& value)
+	{
+		int base = 10;
+		size_t start = position;
+		if (text.compare(start, 2, "0x") == 0 || text.compare(start, 2, "0X") == 0) {
+			base = 16;
+			start += 2;
+		}
+		else if (text.compare(start, 1, "#") == 0) {
+			base = 16;
+			start += 1;
+		}
+
+		// Names such as dt start with a hexadecimal digit, only prefixed numbers are hexadecimal
+		bool digit = start < text.size() && (base == 16 ? std::isxdigit(static_cast<unsigned char>(text[start])) : std::isdigit(static_cast<unsigned char>(text[start])));
+		if (!digit) {
+			return false;
+		}
+
+		char* end;
+		unsigned long parsed = std::strtoul(text.c_str() + start, &end, base);
+		if (parsed > 0xFFFF) {
+			return false;
+		}
+
+		position = end - text.c_str();
+		value = static_cast<uint32_t>(parsed);
+		return true;
+	}
+
+	// Recursive descent, one function per precedence level, tracking the stack depth the bytecode will need
+	class ConditionParser
+	{
+	public:
+		ConditionParser(const std::string& text, std::vector<uint8_t>& code) :
+			text(text),
+			position(0),
+			code(code),
+			depth(0)
+		{
+		}
+
+		bool parse(std::string& parse_error)
+		{
+			bool valid = parse_or();
+			skip_spaces();
+			if (valid && position < text.size()) {
+				valid = fail("unexpected '" + text.substr(position) + "'");
+			}
+			parse_error = error;
+			return valid;
+		}
+
+	private:
+		const std::string& text;
+		size_t position;
+		std::vector<uint8_t>& code;
+		int depth;
+		std::string error;
+
+		bool fail(const std::string& message)
+		{
+			if (error.empty()) {
+				error = message;
+			}
+			return false;
+		}
+
+		bool emit(uint8_t op, int stack_change)
+		{
+			code.push_back(op);
+			depth += stack_change;
+			return depth <= STACK_LIMIT || fail("expression too deep");
+		}
+
+		void skip_spaces()
+		{
+			while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) {
+				++position;
+			}
+		}
+
+		bool accept(const char* token)
+		{
+			skip_spaces();
+			size_t length = std::char_traits<char>::length(token);
+			if (text.compare(position, length, token) != 0) {
+				return false;
+			}
+			position += length;
+			return true;
+		}
+
+		bool parse_or()
+		{
+			if (!parse_and()) {
+				return false;
+			}
+			while (accept("||")) {
+				if (!parse_and() || !emit(OR, -1)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool parse_and()
+		{
+			if (!parse_comparison()) {
+				return false;
+			}
+			while (accept("&&")) {
+				if (!parse_comparison() || !emit(AND, -1)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool parse_comparison()
+		{
+			// Two-character operators first, < would match <= otherwise
+			static const struct { const char* token; ConditionOp op; } comparisons[] = {
+				{ "==", EQUAL }, { "!=", NOT_EQUAL }, { "<=", LESS_EQUAL }, { ">=", GREATER_EQUAL }, { "<", LESS }, { ">", GREATER },
+			};
+
+			if (!parse_sum()) {
+				return false;
+			}
+			for (const auto& comparison : comparisons) {
+				if (accept(comparison.token)) {
+					return parse_sum() && emit(comparison.op, -1);
+				}
+			}
+			return true;
+		}
+
+		bool parse_sum()
+		{
+			if (!parse_primary()) {
+				return false;
+			}
+			while (true) {
+				ConditionOp op;
+				if (accept("+")) {
+					op = ADD;
+				}
+				else if (accept("-")) {
+					op = SUB;
+				}
+				else if (text.compare(position, 2, "&&") != 0 && accept("&")) {
+					op = BIT_AND;
+				}
+				else {
+					return true;
+				}
+
+				if (!parse_primary() || !emit(op, -1)) {
+					return false;
+				}
+			}
+		}
+
+		bool parse_primary()
+		{
+			if (accept("(")) {
+				return parse_or() && (accept(")") || fail("missing ')'"));
+			}
+			if (accept("[")) {
+				return parse_or() && (accept("]") || fail("missing ']'")) && emit(LOAD, 0);
+			}
+			if (accept("!")) {
+				return parse_primary() && emit(NOT, 0);
+			}
+
+			skip_spaces();
+			uint32_t value;
+			if (parse_number(text, position, value)) {
+				code.push_back(PUSH);
+				code.push_back(static_cast<uint8_t>(value >> 8));
+				return emit(static_cast<uint8_t>(value), 1);
+			}
+
+			size_t start = position;
+			while (position < text.size() && std::isalnum(static_cast<unsigned char>(text[position]))) {
+				++position;
+			}
+			std::string name = text.substr(start, position - start);
+			std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+			if (name.size() == 2 && name[0] == 'v' && std::isxdigit(static_cast<unsigned char>(name[1]))) {
+				code.push_back(PUSH_V);
+				return emit(static_cast<uint8_t>(std::stoi(name.substr(1), nullptr, 16)), 1);
+			}
+			if (name == "i") {
+				return emit(PUSH_I, 1);
+			}
+			if (name == "dt") {
+				return emit(PUSH_DT, 1);
+			}
+			if (name == "st") {
+				return emit(PUSH_ST, 1);
+			}
+			if (name == "pc") {
+				return emit(PUSH_PC, 1);
+			}
+			if (name == "sp") {
+				return emit(PUSH_SP, 1);
+			}
+
+			position = start;
+			return fail(position < text.size() ? "unexpected '" + text.substr(position) + "'" : "missing operand");
+		}
+	};
+
+	// "TARGET [if CONDITION]"
+	bool split_spec(const std::string& spec, std::string& target, std::string& condition)
+	{
+		std::istringstream stream(spec);
+		std::string keyword;
+		if (!(stream >> target)) {
+			return false;
+		}
+		if (!(stream >> keyword)) {
+			condition.clear();
+			return true;
+		}
+
+		std::getline(stream, condition);
+		return keyword == "if" && condition.find_first_not_of(" \t") != std::string::npos;
+	}
+
+	std::string hex_address(uint16_t address)
+	{
+		std::ostringstream out;
+		out << "#" << std::uppercase << std::hex << std::setw(3) << std::setfill('0') << address;
+		return out.str();
+	}
+
+	// Registers the instruction stores into, bit x for vx, whatever the value stored. Follows Emulator::decode_opcode.
+	uint16_t registers_stored(uint16_t opcode)
+	{
+		uint16_t x = Emulator::extract(opcode, BitMask::X);
+		switch (Emulator::extract(opcode, BitMask::OP)) {
+		case 0x6:
+		case 0x7:
+		case 0xC:
+			return 1 << x;
+		case 0x8:
+			// 8xy4 to 8xy7 and 8xyE also set VF, stored after vx so that VF holds the flag when x is F
+			switch (Emulator::extract(opcode, BitMask::N)) {
+			case 0x4:
+			case 0x5:
+			case 0x6:
+			case 0x7:
+			case 0xE:
+				return (1 << x) | (1 << 0xF);
+			default:
+				return 1 << x;
+			}
+		case 0xD:
+			return 1 << 0xF;
+		case 0xF:
+			switch (Emulator::extract(opcode, BitMask::KK)) {
+			case 0x07:
+			case 0x0A:
+				return 1 << x;
+			case 0x65:
+				return (2 << x) - 1;
+			}
+			return 0;
+		default:
+			return 0;
+		}
+	}
+
+	// Annn, Fx1E and Fx29 store into I
+	bool stores_index(uint16_t opcode)
+	{
+		uint16_t op = Emulator::extract(opcode, BitMask::OP);
+		uint16_t kk = Emulator::extract(opcode, BitMask::KK);
+		return op == 0xA || (op == 0xF && (kk == 0x1E || kk == 0x29));
+	}
+}
+
+int DebugCondition::compile(const std::string& text, std::string& error)
+{
+	code.clear();
+	if (text.find_first_not_of(" \t") == std::string::npos) {
+		return EXIT_SUCCESS;
+	}
+
+	if (!ConditionParser(text, code).parse(error)) {
+		code.clear();
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+bool DebugCondition::evaluate(const MachineState& state) const
+{
+	if (code.empty()) {
+		return true;
+	}
+
+	int stack[STACK_LIMIT];
+	int top = -1;
+	for (size_t position = 0; position < code.size(); ++position) {
+		switch (code[position]) {
+		case PUSH:
+			stack[++top] = code[position + 1] << 8 | code[position + 2];
+			position += 2;
+			break;
+		case PUSH_V:
+			stack[++top] = state.v[code[++position]];
+			break;
+		case PUSH_I:
+			stack[++top] = state.i;
+			break;
+		case PUSH_DT:
+			stack[++top] = state.dt;
+			break;
+		case PUSH_ST:
+			stack[++top] = state.st;
+			break;
+		case PUSH_PC:
+			stack[++top] = state.pc;
+			break;
+		case PUSH_SP:
+			stack[++top] = state.sp;
+			break;
+		case LOAD:
+			stack[top] = state.memory[stack[top] & MachineState::ADDRESS_MASK];
+			break;
+		case NOT:
+			stack[top] = !stack[top];
+			break;
+		default:
+			// Binary operators, the right operand is on top
+			int right = stack[top--];
+			int& left = stack[top];
+			switch (code[position]) {
+			case ADD:
+				left += right;
+				break;
+			case SUB:
+				left -= right;
+				break;
+			case BIT_AND:
+				left &= right;
+				break;
+			case EQUAL:
+				left = left == right;
+				break;
+			case NOT_EQUAL:
+				left = left != right;
+				break;
+			case LESS:
+				left = left < right;
+				break;
+			case LESS_EQUAL:
+				left = left <= right;
+				break;
+			case GREATER:
+				left = left > right;
+				break;
+			case GREATER_EQUAL:
+				left = left >= right;
+				break;
+			case AND:
+				left = left && right;
+				break;
+			case OR:
+				left = left || right;
+				break;
+			}
+			break;
+		}
+	}
+	return stack[0] != 0;
+}
+
+bool DebugCondition::empty() const
+{
+	return code.empty();
+}
+
+Debugger::Debugger() :
+	watched_registers(0),
+	watched_index(false),
+	last_address(0),
+	memory_written(false),
+	written_address(0),
+	written_size(0),
+	written_registers(0),
+	index_written(false),
+	key_wait(false),
+	resume_cycle(UINT64_MAX),
+	reason(NONE)
+{
+}
+
+int Debugger::add_breakpoint(const std::string& spec)
+{
+	std::string target;
+	std::string condition_text;
+	size_t position = 0;
+	uint32_t value;
+	if (!split_spec(spec, target, condition_text) || !parse_number(target, position, value) || position != target.size()
+		|| value >= MachineState::MEMORY_SIZE) {
+		std::cerr << "Invalid breakpoint, expected ADDRESS [if CONDITION]: " << spec << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Breakpoint breakpoint{ static_cast<uint16_t>(value), DebugCondition(), spec };
+	std::string error;
+	if (breakpoint.condition.compile(condition_text, error) == EXIT_FAILURE) {
+		std::cerr << "Invalid breakpoint condition, " << error << ": " << spec << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	breakpoint_addresses.set(breakpoint.address);
+	breakpoints.push_back(std::move(breakpoint));
+	return EXIT_SUCCESS;
+}
+
+int Debugger::add_watchpoint(const std::string& spec)
+{
+	std::string target;
+	std::string condition_text;
+	if (!split_spec(spec, target, condition_text)) {
+		std::cerr << "Invalid watchpoint, expected vX|i|ADDRESS[+SIZE] [if CONDITION]: " << spec << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Watchpoint watchpoint{ Watchpoint::MEMORY, 0, 1, DebugCondition(), spec };
+	size_t position = 0;
+	uint32_t value;
+	uint32_t size = 1;
+	if ((target[0] == 'v' || target[0] == 'V') && target.size() == 2 && std::isxdigit(static_cast<unsigned char>(target[1]))) {
+		watchpoint.target = Watchpoint::REGISTER;
+		watchpoint.address = static_cast<uint16_t>(std::stoi(target.substr(1), nullptr, 16));
+	}
+	else if (target == "i" || target == "I") {
+		watchpoint.target = Watchpoint::INDEX;
+	}
+	else if (parse_number(target, position, value) && value < MachineState::MEMORY_SIZE
+		&& (position == target.size() || (target[position] == '+' && parse_number(target, ++position, size) && position == target.size()))
+		&& size > 0 && size <= MachineState::MEMORY_SIZE) {
+		watchpoint.address = static_cast<uint16_t>(value);
+		watchpoint.size = static_cast<uint16_t>(size);
+	}
+	else {
+		std::cerr << "Invalid watchpoint, expected vX|i|ADDRESS[+SIZE] [if CONDITION]: " << spec << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string error;
+	if (watchpoint.condition.compile(condition_text, error) == EXIT_FAILURE) {
+		std::cerr << "Invalid watchpoint condition, " << error << ": " << spec << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	switch (watchpoint.target) {
+	case Watchpoint::MEMORY:
+		for (uint16_t offset = 0; offset < watchpoint.size; ++offset) {
+			watched_memory.set((watchpoint.address + offset) & MachineState::ADDRESS_MASK);
+		}
+		break;
+	case Watchpoint::REGISTER:
+		watched_registers |= 1 << watchpoint.address;
+		break;
+	case Watchpoint::INDEX:
+		watched_index = true;
+		break;
+	}
+
+	watchpoints.push_back(std::move(watchpoint));
+	return EXIT_SUCCESS;
+}
+
+void Debugger::clear()
+{
+	breakpoint_addresses.reset();
+	breakpoints.clear();
+	watched_memory.reset();
+	watched_registers = 0;
+	watched_index = false;
+	watchpoints.clear();
+	memory_written = false;
+	written_registers = 0;
+	index_written = false;
+}
+
+bool Debugger::empty() const
+{
+	return breakpoints.empty() && watchpoints.empty();
+}
+
+void Debugger::pause()
+{
+	if (reason == NONE) {
+		stop(PAUSE, "paused");
+	}
+}
+
+void Debugger::resume(const Emulator& emulator)
+{
+	reason = NONE;
+	description.clear();
+	resume_cycle = emulator.cycle_count;
+
+	// Whatever was written while stopped, when stepping or from the host, does not stop the execution resumed
+	memory_written = false;
+	written_registers = 0;
+	index_written = false;
+}
+
+bool Debugger::stopped() const
+{
+	return reason != NONE;
+}
+
+Debugger::StopReason Debugger::stop_reason() const
+{
+	return reason;
+}
+
+const std::string& Debugger::stop_description() const
+{
+	return description;
+}
+
+void Debugger::on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode)
+{
+	last_address = address;
+
+	// Only the watched targets are tracked, stores of the same value count as writes
+	written_registers = registers_stored(opcode) & watched_registers;
+	index_written = watched_index && stores_index(opcode);
+	key_wait = Emulator::extract(opcode, BitMask::OP) == 0xF && Emulator::extract(opcode, BitMask::KK) == 0x0A;
+}
+
+void Debugger::on_memory_write(uint16_t address, uint16_t size)
+{
+	for (uint16_t offset = 0; offset < size; ++offset) {
+		if (watched_memory[(address + offset) & MachineState::ADDRESS_MASK]) {
+			memory_written = true;
+			written_address = address;
+			written_size = size;
+			return;
+		}
+	}
+}
+
+bool Debugger::break_requested(const Emulator& emulator)
+{
+	if (reason != NONE) {
+		return true;
+	}
+
+	if (check_watchpoints(emulator)) {
+		return true;
+	}
+
+	uint16_t pc = emulator.pc & MachineState::ADDRESS_MASK;
+	if (!breakpoint_addresses[pc] || emulator.cycle_count == resume_cycle) {
+		return false;
+	}
+
+	for (const Breakpoint& breakpoint : breakpoints) {
+		if (breakpoint.address == pc && breakpoint.condition.evaluate(emulator)) {
+			stop(BREAKPOINT, "breakpoint " + breakpoint.spec);
+			return true;
+		}
+	}
+	return false;
+}
+
+void Debugger::stop(StopReason stop_reason, const std::string& stop_description)
+{
+	reason = stop_reason;
+	description = stop_description;
+}
+
+// The registers and I written by the previous instruction were decoded from its opcode, memory writes were reported
+bool Debugger::check_watchpoints(const Emulator& emulator)
+{
+	uint16_t stored_registers = written_registers;
+	bool index_stored = index_written;
+	written_registers = 0;
+	index_written = false;
+
+	// Fx0A stores nothing while it waits, it is executed again from the same address
+	if (key_wait && emulator.pc == last_address) {
+		stored_registers = 0;
+	}
+	key_wait = false;
+
+	bool written = memory_written;
+	memory_written = false;
+	if (!stored_registers && !index_stored && !written) {
+		return false;
+	}
+
+	for (const Watchpoint& watchpoint : watchpoints) {
+		bool hit = false;
+		switch (watchpoint.target) {
+		case Watchpoint::MEMORY:
+			for (uint16_t offset = 0; written && offset < written_size && !hit; ++offset) {
+				hit = ((written_address + offset - watchpoint.address) & MachineState::ADDRESS_MASK) < watchpoint.size;
+			}
+			break;
+		case Watchpoint::REGISTER:
+			hit = (stored_registers >> watchpoint.address) & 1;
+			break;
+		case Watchpoint::INDEX:
+			hit = index_stored;
+			break;
+		}
+
+		if (hit && watchpoint.condition.evaluate(emulator)) {
+			stop(WATCHPOINT, "watchpoint " + watchpoint.spec + " written by " + hex_address(last_address));
+			return true;
+		}
+	}
+	return false;
+}
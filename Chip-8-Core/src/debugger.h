@@ -0,0 +1,106 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "execution_observer.h"
+#include "machine_state.h"
+
+// Condition of a breakpoint or watchpoint, compiled once into a small stack bytecode and evaluated on every hit.
+// Operands are numbers (decimal, 0x2A4 or #2A4), the registers v0 to vf, i, dt, st, pc, sp, and [expression] for the
+// memory byte at an address. Operators by increasing precedence: ||, &&, comparisons (== != < <= > >=), + - &, and !
+class DebugCondition
+{
+public:
+	// An empty text is always true. EXIT_FAILURE with the reason in error when the text is not a valid expression
+	int compile(const std::string& text, std::string& error);
+	bool evaluate(const MachineState& state) const;
+	bool empty() const;
+
+private:
+	std::vector<uint8_t> code;
+};
+
+// Runtime breakpoints and watchpoints, in release builds as well. Attached as the observer of an emulator, which then
+// runs the interpreter and asks break_requested before every instruction: breakpoints are one bit per address, and the
+// watched memory bytes, registers and I are only looked at when written. A write hits even when it stores the value
+// already there. Detach it when empty() so that nothing is paid.
+class Debugger : public ExecutionObserver
+{
+public:
+	enum StopReason {
+		NONE,
+		PAUSE,
+		BREAKPOINT,		// before executing the instruction at pc
+		WATCHPOINT,		// after the previous instruction wrote the watched location
+	};
+
+	Debugger();
+
+	// "ADDRESS [if CONDITION]", EXIT_FAILURE with a message on std::cerr when invalid
+	int add_breakpoint(const std::string& spec);
+
+	// "vX|i|ADDRESS[+SIZE] [if CONDITION]", EXIT_FAILURE with a message on std::cerr when invalid
+	int add_watchpoint(const std::string& spec);
+
+	void clear();
+	bool empty() const;
+
+	// Stop before the next instruction, or keep executing from the current stop
+	void pause();
+	void resume(const Emulator& emulator);
+
+	bool stopped() const;
+	StopReason stop_reason() const;
+	const std::string& stop_description() const;
+
+	void on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode) override;
+	void on_memory_write(uint16_t address, uint16_t size) override;
+	bool break_requested(const Emulator& emulator) override;
+
+private:
+	struct Breakpoint
+	{
+		uint16_t address;
+		DebugCondition condition;
+		std::string spec;
+	};
+
+	struct Watchpoint
+	{
+		enum Target {
+			MEMORY,
+			REGISTER,
+			INDEX,
+		};
+
+		Target target;
+		uint16_t address;	// first byte for MEMORY, register number for REGISTER
+		uint16_t size;
+		DebugCondition condition;
+		std::string spec;
+	};
+
+	std::bitset<MachineState::MEMORY_SIZE> breakpoint_addresses;
+	std::vector<Breakpoint> breakpoints;			// conditions, only looked up when the address bit is set
+	std::bitset<MachineState::MEMORY_SIZE> watched_memory;
+	uint16_t watched_registers;						// bit x set when vx is watched
+	bool watched_index;
+	std::vector<Watchpoint> watchpoints;
+
+	// Write tracking since the previous instruction
+	uint16_t last_address;
+	bool memory_written;
+	uint16_t written_address;
+	uint16_t written_size;
+	uint16_t written_registers;						// watched ones only, decoded from the opcode
+	bool index_written;
+	bool key_wait;									// Fx0A, which writes vx only once a key is pressed
+
+	uint64_t resume_cycle;							// breakpoints are not hit again by the instruction resumed from
+	StopReason reason;
+	std::string description;
+
+	void stop(StopReason stop_reason, const std::string& stop_description);
+	bool check_watchpoints(const Emulator& emulator);
+};
@@ -0,0 +1,169 @@
+#include "disassembler.h"
+#include "emulator.h"
+#include <iomanip>
+#include <sstream>
+
+const char* const INSTRUCTION_NAMES[] = {
+	"cls", "ret", "jp_addr", "call_addr", "se_vx_byte", "sne_vx_byte", "se_vx_vy", "ld_vx_byte", "add_vx_byte",
+	"ld_vx_vy", "or_vx_vy", "and_vx_vy", "xor_vx_vy", "add_vx_vy", "sub_vx_vy", "shr_vx_vy", "subn_vx_vy", "shl_vx_vy",
+	"sne_vx_vy", "ld_i_addr", "jp_v0_addr", "rnd_vx_byte", "drw_vx_vy_nibble", "skp_vx", "sknp_vx",
+	"ld_vx_dt", "ld_vx_k", "ld_dt_vx", "ld_st_vx", "add_i_vx", "ld_f_vx", "ld_b_vx", "ld_i_vx", "ld_vx_i",
+};
+const int INSTRUCTION_KIND_COUNT = sizeof(INSTRUCTION_NAMES) / sizeof(INSTRUCTION_NAMES[0]);
+
+int instruction_kind(uint16_t opcode)
+{
+	switch (Emulator::extract(opcode, BitMask::OP)) {
+	case 0x0:
+		return opcode == 0x00E0 ? 0 : opcode == 0x00EE ? 1 : -1;
+	case 0x8: {
+		// 8xy0 to 8xy7 are in order, then 8xyE
+		uint16_t n = Emulator::extract(opcode, BitMask::N);
+		return n <= 0x7 ? 9 + n : n == 0xE ? 17 : -1;
+	}
+	case 0x9:
+		return 18;
+	case 0xE:
+		switch (Emulator::extract(opcode, BitMask::KK)) {
+		case 0x9E:
+			return 23;
+		case 0xA1:
+			return 24;
+		default:
+			return -1;
+		}
+	case 0xF:
+		switch (Emulator::extract(opcode, BitMask::KK)) {
+		case 0x07:
+			return 25;
+		case 0x0A:
+			return 26;
+		case 0x15:
+			return 27;
+		case 0x18:
+			return 28;
+		case 0x1E:
+			return 29;
+		case 0x29:
+			return 30;
+		case 0x33:
+			return 31;
+		case 0x55:
+			return 32;
+		case 0x65:
+			return 33;
+		default:
+			return -1;
+		}
+	default: {
+		// 1nnn to 7xkk follow cls and ret, Annn to Dxyn follow sne_vx_vy; 5xyN ignores its low nibble like decode_opcode
+		static const int KINDS[] = { -1, 2, 3, 4, 5, 6, 7, 8, -1, -1, 19, 20, 21, 22 };
+		return KINDS[Emulator::extract(opcode, BitMask::OP)];
+	}
+	}
+}
+
+bool valid_opcode(uint16_t opcode)
+{
+	return instruction_kind(opcode) >= 0;
+}
+
+std::string disassemble(uint16_t opcode)
+{
+	std::ostringstream out;
+	out << std::uppercase << std::hex;
+
+	if (!valid_opcode(opcode)) {
+		out << "DW #" << std::setw(4) << std::setfill('0') << opcode;
+		return out.str();
+	}
+
+	uint16_t x = Emulator::extract(opcode, BitMask::X);
+	uint16_t y = Emulator::extract(opcode, BitMask::Y);
+	uint16_t n = Emulator::extract(opcode, BitMask::N);
+	uint16_t kk = Emulator::extract(opcode, BitMask::KK);
+	uint16_t nnn = Emulator::extract(opcode, BitMask::NNN);
+
+	static const char* const ALU_MNEMONICS[] = { "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN" };
+
+	switch (Emulator::extract(opcode, BitMask::OP)) {
+	case 0x0:
+		out << (opcode == 0x00E0 ? "CLS" : "RET");
+		break;
+	case 0x1:
+		out << "JP #" << nnn;
+		break;
+	case 0x2:
+		out << "CALL #" << nnn;
+		break;
+	case 0x3:
+		out << "SE V" << x << ", #" << kk;
+		break;
+	case 0x4:
+		out << "SNE V" << x << ", #" << kk;
+		break;
+	case 0x5:
+		out << "SE V" << x << ", V" << y;
+		break;
+	case 0x6:
+		out << "LD V" << x << ", #" << kk;
+		break;
+	case 0x7:
+		out << "ADD V" << x << ", #" << kk;
+		break;
+	case 0x8:
+		out << (n == 0xE ? "SHL" : ALU_MNEMONICS[n]) << " V" << x << ", V" << y;
+		break;
+	case 0x9:
+		out << "SNE V" << x << ", V" << y;
+		break;
+	case 0xA:
+		out << "LD I, #" << nnn;
+		break;
+	case 0xB:
+		out << "JP V0, #" << nnn;
+		break;
+	case 0xC:
+		out << "RND V" << x << ", #" << kk;
+		break;
+	case 0xD:
+		out << "DRW V" << x << ", V" << y << ", " << n;
+		break;
+	case 0xE:
+		out << (kk == 0x9E ? "SKP V" : "SKNP V") << x;
+		break;
+	case 0xF:
+		switch (kk) {
+		case 0x07:
+			out << "LD V" << x << ", DT";
+			break;
+		case 0x0A:
+			out << "LD V" << x << ", K";
+			break;
+		case 0x15:
+			out << "LD DT, V" << x;
+			break;
+		case 0x18:
+			out << "LD ST, V" << x;
+			break;
+		case 0x1E:
+			out << "ADD I, V" << x;
+			break;
+		case 0x29:
+			out << "LD F, V" << x;
+			break;
+		case 0x33:
+			out << "LD B, V" << x;
+			break;
+		case 0x55:
+			out << "LD [I], V" << x;
+			break;
+		case 0x65:
+			out << "LD V" << x << ", [I]";
+			break;
+		}
+		break;
+	}
+
+	return out.str();
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Mnemonics of the technical reference, "DW #xxxx" for words that are not instructions
+std::string disassemble(uint16_t opcode);
+
+// Same decoding rules as Emulator::decode_opcode
+bool valid_opcode(uint16_t opcode);
+
+// Index in INSTRUCTION_NAMES of the decode_opcode case executing the opcode, -1 for words that are not instructions
+int instruction_kind(uint16_t opcode);
+
+extern const char* const INSTRUCTION_NAMES[]; // names of the Emulator instruction handlers
+extern const int INSTRUCTION_KIND_COUNT;
@@ -1,8 +1,11 @@
 ﻿#include "emulator.h"
-#include <conio.h>
+#include <cstring>
+#include <ctime>
 #include <fstream>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <stdexcept>
 
 uint16_t Emulator::extract(uint16_t word, BitMask mask)
 {
@@ -25,34 +28,260 @@ uint16_t Emulator::extract(uint16_t word, BitMask mask)
 }
 
 Emulator::Emulator() :
-	memory{ 0 },
-	i(0x200),
-	stack{ 0 },
-	sp(0),
-	v{ 0 },
-	dt(0),
-	st(0),
-	pc(0x200),
-	inputs_mask(0),
-	display{ 0 },
-	draw_flag(false)
+	backend(std::make_unique<InterpreterBackend>()),
+	observer(nullptr)
 {
 }
 
+// Copies get their own backend, caches follow the memory they were built from
+Emulator::Emulator(const Emulator& other) :
+	MachineState(other),
+	backend(other.backend->clone()),
+	observer(nullptr)
+{
+}
+
+Emulator& Emulator::operator=(const Emulator& other)
+{
+	MachineState::operator=(other);
+	backend = other.backend->clone();
+	return *this;
+}
+
 int Emulator::init(const std::string program_path)
 {
-	std::srand(static_cast<unsigned int>(std::time(0)));
+	seed(static_cast<uint32_t>(std::time(0)));
 	init_sprites();
 	return read_program(program_path);
 }
 
+int Emulator::init(const uint8_t* program, size_t size)
+{
+	seed(static_cast<uint32_t>(std::time(0)));
+	init_sprites();
+	return load_program(program, size);
+}
+
+// Load program at beginning of memory, without any file access or output
+int Emulator::load_program(const uint8_t* program, size_t size)
+{
+	if (size > static_cast<size_t>(MEMORY_SIZE - pc)) {
+		return EXIT_FAILURE;
+	}
+
+	std::memcpy(memory + pc, program, size);
+	backend->flush();
+	return EXIT_SUCCESS;
+}
+
 bool Emulator::cycle()
 {
+	if (input_head != input_tail) {
+		apply_inputs();
+	}
+
 	uint16_t opcode = fetch_opcode();
+	if (observer) {
+		observer->on_instruction(*this, pc & ADDRESS_MASK, opcode);
+	}
 	pc += 2;
 
+	status = RUNNING;
 	decode_opcode(opcode);
+	++cycle_count;
+
+	uint16_t next_opcode = fetch_opcode();
+	return next_opcode != 0;
+}
+
+// Execute exactly cycles instructions with the backend unless the program ends, the timers are not ticked
+bool Emulator::run_cycles(uint64_t cycles)
+{
+	if (observer) {
+		return run_observed(cycles, false);
+	}
+	return backend->run_cycles(*this, cycles);
+}
+
+// Run the instructions of one frame then tick the timers
+bool Emulator::run_frame()
+{
+	cycle_budget += CPU_FREQUENCY;
+	uint64_t cycles = cycle_budget / TIMER_FREQUENCY;
+	cycle_budget -= static_cast<int>(cycles) * TIMER_FREQUENCY;
+
+	uint64_t start_cycle = cycle_count;
+	bool running = observer ? run_observed(cycles, true) : backend->run_frame(*this, cycles);
+
+	if (blocked()) {
+		cycle_budget = 0;
+	}
+	else {
+		// Program ended before the end of the frame, keep the unused cycles like a partial frame
+		cycle_budget += static_cast<int>(cycles - (cycle_count - start_cycle)) * TIMER_FREQUENCY;
+	}
+
+	tick_timers();
+	return running;
+}
+
+// 11 or 12, CPU_FREQUENCY / TIMER_FREQUENCY with the remainder carried by cycle_budget
+uint64_t Emulator::next_frame_cycles() const
+{
+	return (cycle_budget + CPU_FREQUENCY) / TIMER_FREQUENCY;
+}
+
+// Slow path of observed emulators: every instruction goes through cycle so that it is reported, and the observer can
+// stop the execution between two instructions. The backend is left untouched, unobserved runs pay nothing for it.
+bool Emulator::run_observed(uint64_t cycles, bool stop_when_blocked)
+{
+	bool running = true;
+	for (uint64_t executed = 0; running && executed < cycles; ++executed) {
+		if (observer->break_requested(*this)) {
+			break;
+		}
+		running = cycle();
+		if (stop_when_blocked && blocked()) {
+			break;
+		}
+	}
+	return running;
+}
+
+// The remaining cycles would execute the same instruction again, unless a key event is due
+bool Emulator::blocked() const
+{
+	return status == HALTED || (status == WAITING_FOR_INPUT && input_head == input_tail);
+}
+
+// Only an external event can change the machine: it is halted or waiting for a key, and both timers expired
+bool Emulator::idle() const
+{
+	bool stopped = status == HALTED || (status == WAITING_FOR_INPUT && !inputs_mask && input_head == input_tail);
+	return stopped && dt == 0 && st == 0;
+}
+
+void Emulator::set_backend(std::unique_ptr<ExecutionBackend> new_backend)
+{
+	backend = std::move(new_backend);
+	backend->flush();
+}
+
+const ExecutionBackend& Emulator::execution_backend() const
+{
+	return *backend;
+}
+
+void Emulator::set_observer(ExecutionObserver* new_observer)
+{
+	observer = new_observer;
+}
+
+ExecutionObserver* Emulator::execution_observer() const
+{
+	return observer;
+}
+
+void Emulator::invalidate(uint16_t address, uint16_t size)
+{
+	backend->invalidate(address, size);
+}
+
+const MachineState& Emulator::save_state() const
+{
+	return *this;
+}
+
+void Emulator::load_state(const MachineState& state)
+{
+	MachineState::operator=(state);
+	backend->flush();
+}
+
+void Emulator::rewind_state(const MachineState& state)
+{
+	const int BLOCK_SIZE = 64;
+	for (int address = 0; address < MEMORY_SIZE; address += BLOCK_SIZE) {
+		if (std::memcmp(memory + address, state.memory + address, BLOCK_SIZE) != 0) {
+			backend->invalidate(address, BLOCK_SIZE);
+		}
+	}
+	MachineState::operator=(state);
+}
+
+// Programs are deterministic for a given seed, which regression runs rely on
+void Emulator::seed(uint32_t value)
+{
+	rng_state = value ? value : 0x2545F491; // xorshift state must not be zero
+}
+
+uint64_t Emulator::display_hash() const
+{
+	// FNV-1a
+	uint64_t hash = 0xCBF29CE484222325;
+	for (bool pixel : display) {
+		hash ^= pixel;
+		hash *= 0x100000001B3;
+	}
+	return hash;
+}
+
+// Everything that influences future execution, cheap enough to compare machines every few thousand cycles
+uint64_t Emulator::state_hash() const
+{
+	// FNV-1a
+	uint64_t hash = 0xCBF29CE484222325;
+	auto mix = [&hash](const void* data, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t idx = 0; idx < size; ++idx) {
+			hash ^= bytes[idx];
+			hash *= 0x100000001B3;
+		}
+	};
+
+	mix(memory, sizeof(memory));
+	mix(&i, sizeof(i));
+	mix(stack, sizeof(stack));
+	mix(&sp, sizeof(sp));
+	mix(v, sizeof(v));
+	mix(&dt, sizeof(dt));
+	mix(&st, sizeof(st));
+	mix(&pc, sizeof(pc));
+	mix(&inputs_mask, sizeof(inputs_mask));
+	mix(display, sizeof(display));
+	mix(&status, sizeof(status));
+	mix(&cycle_count, sizeof(cycle_count));
+	return hash;
+}
+
+// Schedule a key change at the given value of cycle_count, events must be queued in cycle order
+bool Emulator::queue_input(uint64_t cycle, uint8_t key, bool pressed)
+{
+	if (input_tail - input_head == INPUT_QUEUE_SIZE) {
+		return false;
+	}
 
+	input_queue[input_tail % INPUT_QUEUE_SIZE] = { cycle, key, pressed };
+	++input_tail;
+	return true;
+}
+
+void Emulator::apply_inputs()
+{
+	while (input_head != input_tail && input_queue[input_head % INPUT_QUEUE_SIZE].cycle <= cycle_count) {
+		const InputEvent& event = input_queue[input_head % INPUT_QUEUE_SIZE];
+		if (event.pressed) {
+			inputs_mask |= (1 << event.key);
+		}
+		else {
+			inputs_mask &= ~(1 << event.key);
+		}
+		++input_head;
+	}
+}
+
+void Emulator::tick_timers()
+{
 	if (dt > 0) {
 		--dt;
 	}
@@ -61,9 +290,6 @@ bool Emulator::cycle()
 		// Buzzing sound
 		--st;
 	}
-
-	uint16_t next_opcode = fetch_opcode();
-	return next_opcode != 0;
 }
 
 int Emulator::read_program(const std::string& program_path)
@@ -79,6 +305,11 @@ int Emulator::read_program(const std::string& program_path)
 	auto file_size = input_file.tellg();
 	input_file.seekg(0, std::ios::beg);
 
+	if (file_size > MEMORY_SIZE - pc) {
+		std::cerr << "Program file too large: " << program_path << " (" << file_size << " bytes)" << std::endl;
+		return EXIT_FAILURE;
+	}
+
 	// Load program at beginning of memory
 	input_file.read(reinterpret_cast<char*>(memory + pc), file_size);
 	input_file.close();
@@ -88,12 +319,23 @@ int Emulator::read_program(const std::string& program_path)
 		return EXIT_FAILURE;
 	}
 
+	backend->flush();
+
 	const auto& filename = std::filesystem::path(program_path).filename();
 	std::cout << "Successfully read " << input_file.gcount() << " bytes from " << filename << std::endl;
 
 	return EXIT_SUCCESS;
 }
 
+// xorshift32, one random byte per call
+uint8_t Emulator::next_random()
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return static_cast<uint8_t>(rng_state >> 24);
+}
+
 void Emulator::init_sprites()
 {
 	const uint8_t length = 80;
@@ -139,7 +381,7 @@ void Emulator::init_sprites()
 
 uint16_t Emulator::fetch_opcode() const
 {
-	return memory[pc] << 8 | memory[pc + 1];
+	return memory[pc & ADDRESS_MASK] << 8 | memory[(pc + 1) & ADDRESS_MASK];
 }
 
 void Emulator::decode_opcode(uint16_t opcode)
@@ -148,8 +390,6 @@ void Emulator::decode_opcode(uint16_t opcode)
 	std::cout << std::uppercase << std::setw(4) << std::setfill('0') << std::hex << opcode << std::dec << " - ";
 #endif
 
-	draw_flag = false;
-
 	switch (extract(opcode, BitMask::OP)) {
 	case 0x0:
 		switch (opcode) {
@@ -303,6 +543,10 @@ void Emulator::ret()
 	std::cout << "RET | PC = " << stack[sp] << "; SP = " << (sp - 1) << std::endl;
 #endif
 
+	if (sp == 0) {
+		throw std::out_of_range("stack underflow");
+	}
+
 	pc = stack[sp] + 2;
 	--sp;
 }
@@ -314,6 +558,11 @@ void Emulator::jp_addr(uint16_t nnn)
 	std::cout << "JP | PC = " << nnn << std::endl;
 #endif
 
+	// Jumping to itself is how programs stop, nothing but the timers can change afterwards
+	if (nnn == pc - 2) {
+		status = HALTED;
+	}
+
 	pc = nnn;
 }
 
@@ -324,6 +573,10 @@ void Emulator::call_addr(uint16_t nnn)
 	std::cout << "CALL | SP = " << static_cast<int>(sp + 1) << "; stack[SP] = " << (pc - 2) << "; PC = " << nnn << std::endl;
 #endif
 
+	if (sp == STACK_SIZE - 1) {
+		throw std::out_of_range("stack overflow");
+	}
+
 	++sp;
 	stack[sp] = pc - 2;
 	pc = nnn;
@@ -516,7 +769,7 @@ void Emulator::jp_v0_addr(uint16_t nnn)
 // Set Vx = random byte AND kk
 void Emulator::rnd_vx_byte(uint16_t x, uint16_t kk)
 {
-	uint8_t value = (rand() % 256) & kk;
+	uint8_t value = next_random() & kk;
 #if _DEBUG
 	std::cout << "RND | V[" << x << "] = " << static_cast<int>(value) << std::endl;
 #endif
@@ -531,13 +784,17 @@ void Emulator::drw_vx_vy_nibble(uint16_t x, uint16_t y, uint16_t n)
 	std::cout << "DRW | START=(V[" << x << "], V[" << y << "]) = (" << static_cast<uint16_t>(v[x]) << "," << static_cast<uint16_t>(v[y]) << "); N = " << n << std::endl;
 #endif
 
-	uint16_t start_x_pos = v[x];
-	uint16_t y_pos = v[y];
+	// Sprites starting off screen wrap like the ones crossing an edge
+	uint16_t start_x_pos = v[x] % DISPLAY_WIDTH;
+	uint16_t y_pos = v[y] % DISPLAY_HEIGHT;
 
 	v[0xF] = 0;
+	if (observer) {
+		observer->on_memory_read(i & ADDRESS_MASK, n);
+	}
 
 	for (uint16_t byte_idx = 0; byte_idx < n; ++byte_idx) {
-		uint8_t curr_byte = memory[i + byte_idx];
+		uint8_t curr_byte = memory[(i + byte_idx) & ADDRESS_MASK];
 
 		uint16_t x_pos = start_x_pos;
 		for (uint8_t bit_idx = 0; bit_idx < 8; ++bit_idx) {
@@ -563,12 +820,13 @@ void Emulator::drw_vx_vy_nibble(uint16_t x, uint16_t y, uint16_t n)
 	}
 
 	draw_flag = true;
+	++draw_count;
 }
 
 // Skip next instruction if key with the value of Vx is pressed
 void Emulator::skp_vx(uint16_t x)
 {
-	bool key_pressed = static_cast<bool>(inputs_mask & (1 << v[x]));
+	bool key_pressed = static_cast<bool>(inputs_mask & (1 << (v[x] & 0xF)));
 #if _DEBUG
 	std::cout << "SKP | Skip if " << x << " is pressed (" << key_pressed << ")" << std::endl;
 #endif
@@ -581,7 +839,7 @@ void Emulator::skp_vx(uint16_t x)
 // Skip next instruction if key with the value of Vx is not pressed
 void Emulator::sknp_vx(uint16_t x)
 {
-	bool key_pressed = static_cast<bool>(inputs_mask & (1 << v[x]));
+	bool key_pressed = static_cast<bool>(inputs_mask & (1 << (v[x] & 0xF)));
 #if _DEBUG
 	std::cout << "SKNP | Skip if " << x << " is not pressed (" << !key_pressed << ")" << std::endl;
 #endif
@@ -608,13 +866,16 @@ void Emulator::ld_vx_k(uint16_t x)
 	std::cout << "LD | Wait for key press" << std::endl;
 #endif
 
+	// Execute this instruction again until a key is pressed
 	if (!inputs_mask) {
+		pc -= 2;
+		status = WAITING_FOR_INPUT;
 		return;
 	}
 
-	for (uint8_t i = 15; i >= 0; --i) {
-		if (inputs_mask & (1 << i)) {
-			v[x] = i;
+	for (int key = 15; key >= 0; --key) {
+		if (inputs_mask & (1 << key)) {
+			v[x] = key;
 			return;
 		}
 	}
@@ -672,9 +933,13 @@ void Emulator::ld_b_vx(uint16_t x)
 	std::cout << "LD | MEM[" << i << "] = " << static_cast<int>(hundreds) << "; MEM[" << (i + 1) << "] = " << static_cast<int>(tens) << "; MEM[" << (i + 2) << "] = " << static_cast<int>(ones) << std::endl;
 #endif
 
-	memory[i] = hundreds;
-	memory[i + 1] = tens;
-	memory[i + 2] = ones;
+	memory[i & ADDRESS_MASK] = hundreds;
+	memory[(i + 1) & ADDRESS_MASK] = tens;
+	memory[(i + 2) & ADDRESS_MASK] = ones;
+	backend->invalidate(i, 3);
+	if (observer) {
+		observer->on_memory_write(i & ADDRESS_MASK, 3);
+	}
 }
 
 // Store registers V0 through Vx in memory starting at location I
@@ -685,11 +950,15 @@ void Emulator::ld_i_vx(uint16_t x)
 #endif
 
 	for (int idx = 0; idx < x + 1; ++idx) {
-		memory[i + idx] = v[idx];
+		memory[(i + idx) & ADDRESS_MASK] = v[idx];
 #if _DEBUG
 		std::cout << "MEM[" << (i + idx) << "] = V[" << idx << "] (" << static_cast<int>(v[idx]) << "); ";
 #endif
 	}
+	backend->invalidate(i, x + 1);
+	if (observer) {
+		observer->on_memory_write(i & ADDRESS_MASK, x + 1);
+	}
 
 #if _DEBUG
 	std::cout << std::endl;
@@ -703,10 +972,13 @@ void Emulator::ld_vx_i(uint16_t x)
 	std::cout << "LD | ";
 #endif
 
+	if (observer) {
+		observer->on_memory_read(i & ADDRESS_MASK, x + 1);
+	}
 	for (int idx = 0; idx < x + 1; ++idx) {
-		v[idx] = memory[i + idx];
+		v[idx] = memory[(i + idx) & ADDRESS_MASK];
 #if _DEBUG
-		std::cout << "V[" << idx << "] = MEM[" << (i + idx) << "] (" << static_cast<int>(memory[i + idx]) << "); ";
+		std::cout << "V[" << idx << "] = MEM[" << (i + idx) << "] (" << static_cast<int>(memory[(i + idx) & ADDRESS_MASK]) << "); ";
 #endif
 	}
 
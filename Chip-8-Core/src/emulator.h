@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "execution_backend.h"
+#include "execution_observer.h"
+#include "machine_state.h"
+
+enum BitMask {
+	NNN,	// 0000 XXXX XXXX XXXX (nnn or addr)
+	N,		// 0000 0000 0000 XXXX (n or nibble)
+	X,		// 0000 XXXX 0000 0000 (x)
+	Y,		// 0000 0000 XXXX 0000 (y)
+	KK,		// 0000 0000 XXXX XXXX (kk or byte)
+	OP,		// XXXX 0000 0000 0000 (op code)
+};
+
+class Emulator : public MachineState
+{
+public:
+	static uint16_t extract(uint16_t word, BitMask mask);
+
+	Emulator();
+	Emulator(const Emulator& other);
+	Emulator& operator=(const Emulator& other);
+
+	int init(const std::string program_path);
+	int init(const uint8_t* program, size_t size);
+	int load_program(const uint8_t* program, size_t size);
+	bool cycle();
+	bool run_cycles(uint64_t cycles);
+	bool run_frame();
+	uint64_t next_frame_cycles() const; // instructions the next run_frame executes, unless blocked or stopped
+	bool blocked() const;
+	bool idle() const;
+	void tick_timers();
+	bool queue_input(uint64_t cycle, uint8_t key, bool pressed);
+	void seed(uint32_t value);
+	uint64_t display_hash() const;
+	uint64_t state_hash() const;
+
+	// Execution backend of this instance, the decode_opcode interpreter by default
+	void set_backend(std::unique_ptr<ExecutionBackend> new_backend);
+	const ExecutionBackend& execution_backend() const;
+
+	// Not owned, nullptr to detach. Copies of the emulator are not observed
+	void set_observer(ExecutionObserver* new_observer);
+	ExecutionObserver* execution_observer() const;
+
+	// Memory was changed from outside of the executed instructions
+	void invalidate(uint16_t address, uint16_t size);
+
+	const MachineState& save_state() const;
+	void load_state(const MachineState& state);
+
+	// Back to a snapshot taken from this same program, e.g. after running ahead. Unlike load_state only the memory
+	// that differs is invalidated in the backend, its caches survive
+	void rewind_state(const MachineState& state);
+
+private:
+	friend class HandlerBenchmark; // Chip-8-Bench times the instruction handlers directly
+	friend class CachedBackend; // dispatches to the instruction handlers from its decoded instruction cache
+
+	std::unique_ptr<ExecutionBackend> backend;
+	ExecutionObserver* observer;
+
+	int read_program(const std::string& path);
+	void init_sprites();
+	void apply_inputs();
+	bool run_observed(uint64_t cycles, bool stop_when_blocked);
+	uint8_t next_random();
+
+	uint16_t fetch_opcode() const;
+	void decode_opcode(uint16_t word);
+
+	void cls();
+	void ret();
+	void jp_addr(uint16_t nnn);
+	void call_addr(uint16_t nnn);
+	void se_vx_byte(uint16_t x, uint16_t kk);
+	void sne_vx_byte(uint16_t x, uint16_t kk);
+	void se_vx_vy(uint16_t x, uint16_t y);
+	void ld_vx_byte(uint16_t x, uint16_t y);
+	void add_vx_byte(uint16_t x, uint16_t kk);
+	void ld_vx_vy(uint16_t x, uint16_t y);
+	void or_vx_vy(uint16_t x, uint16_t y);
+	void and_vx_vy(uint16_t x, uint16_t y);
+	void xor_vx_vy(uint16_t x, uint16_t y);
+	void add_vx_vy(uint16_t x, uint16_t y);
+	void sub_vx_vy(uint16_t x, uint16_t y);
+	void shr_vx_vy(uint16_t x, uint16_t y);
+	void subn_vx_vy(uint16_t x, uint16_t y);
+	void shl_vx_vy(uint16_t x, uint16_t y);
+	void sne_vx_vy(uint16_t x, uint16_t y);
+	void ld_i_addr(uint16_t nnn);
+	void jp_v0_addr(uint16_t nnn);
+	void rnd_vx_byte(uint16_t x, uint16_t kk);
+	void drw_vx_vy_nibble(uint16_t x, uint16_t y, uint16_t n);
+	void skp_vx(uint16_t x);
+	void sknp_vx(uint16_t x);
+	void ld_vx_dt(uint16_t x);
+	void ld_vx_k(uint16_t x);
+	void ld_dt_vx(uint16_t x);
+	void ld_st_vx(uint16_t x);
+	void add_i_vx(uint16_t x);
+	void ld_f_vx(uint16_t x);
+	void ld_b_vx(uint16_t x);
+	void ld_i_vx(uint16_t x);
+	void ld_vx_i(uint16_t x);
+};
@@ -0,0 +1,57 @@
+#include "execution_backend.h"
+#include "cached_backend.h"
+#include "emulator.h"
+
+const char* const BACKEND_NAMES[] = { "interpreter", "cached" };
+const int BACKEND_COUNT = sizeof(BACKEND_NAMES) / sizeof(BACKEND_NAMES[0]);
+
+std::unique_ptr<ExecutionBackend> make_backend(const std::string& name)
+{
+	if (name == "interpreter") {
+		return std::make_unique<InterpreterBackend>();
+	}
+	else if (name == "cached") {
+		return std::make_unique<CachedBackend>();
+	}
+	return nullptr;
+}
+
+const char* InterpreterBackend::name() const
+{
+	return "interpreter";
+}
+
+std::unique_ptr<ExecutionBackend> InterpreterBackend::clone() const
+{
+	return std::make_unique<InterpreterBackend>(*this);
+}
+
+bool InterpreterBackend::run_cycles(Emulator& emulator, uint64_t cycles)
+{
+	bool running = true;
+	for (uint64_t cycle = 0; running && cycle < cycles; ++cycle) {
+		running = emulator.cycle();
+	}
+	return running;
+}
+
+bool InterpreterBackend::run_frame(Emulator& emulator, uint64_t cycles)
+{
+	bool running = true;
+	for (uint64_t cycle = 0; running && cycle < cycles; ++cycle) {
+		running = emulator.cycle();
+		if (emulator.blocked()) {
+			break;
+		}
+	}
+	return running;
+}
+
+void InterpreterBackend::invalidate(uint16_t address, uint16_t size)
+{
+	// Decodes every instruction when executing it, nothing to invalidate
+}
+
+void InterpreterBackend::flush()
+{
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class Emulator;
+
+// Engine executing instructions on the state of an Emulator. Each instance owns its backend, selected at runtime
+class ExecutionBackend
+{
+public:
+	virtual ~ExecutionBackend() = default;
+
+	virtual const char* name() const = 0;
+
+	// Fresh copy for another emulator, with its own caches
+	virtual std::unique_ptr<ExecutionBackend> clone() const = 0;
+
+	// Execute exactly cycles instructions unless the program ends, false once it ended
+	virtual bool run_cycles(Emulator& emulator, uint64_t cycles) = 0;
+
+	// Same as run_cycles but also stop once Emulator::blocked, the rest of the frame would repeat the same instruction
+	virtual bool run_frame(Emulator& emulator, uint64_t cycles) = 0;
+
+	// Memory in [address, address + size) changed, addresses wrap around the address space
+	virtual void invalidate(uint16_t address, uint16_t size) = 0;
+
+	// Forget everything derived from memory, after a program or a snapshot was loaded
+	virtual void flush() = 0;
+};
+
+// Reference engine, every instruction goes through Emulator::cycle and decode_opcode
+class InterpreterBackend : public ExecutionBackend
+{
+public:
+	const char* name() const override;
+	std::unique_ptr<ExecutionBackend> clone() const override;
+	bool run_cycles(Emulator& emulator, uint64_t cycles) override;
+	bool run_frame(Emulator& emulator, uint64_t cycles) override;
+	void invalidate(uint16_t address, uint16_t size) override;
+	void flush() override;
+};
+
+extern const char* const BACKEND_NAMES[];
+extern const int BACKEND_COUNT;
+
+// nullptr when there is no backend with that name
+std::unique_ptr<ExecutionBackend> make_backend(const std::string& name);
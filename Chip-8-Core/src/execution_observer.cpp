@@ -0,0 +1,42 @@
+#include "execution_observer.h"
+
+void ObserverGroup::add(ExecutionObserver* observer)
+{
+	observers.push_back(observer);
+}
+
+bool ObserverGroup::empty() const
+{
+	return observers.empty();
+}
+
+void ObserverGroup::on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode)
+{
+	for (ExecutionObserver* observer : observers) {
+		observer->on_instruction(emulator, address, opcode);
+	}
+}
+
+void ObserverGroup::on_memory_read(uint16_t address, uint16_t size)
+{
+	for (ExecutionObserver* observer : observers) {
+		observer->on_memory_read(address, size);
+	}
+}
+
+void ObserverGroup::on_memory_write(uint16_t address, uint16_t size)
+{
+	for (ExecutionObserver* observer : observers) {
+		observer->on_memory_write(address, size);
+	}
+}
+
+// Every observer is asked, those tracking changes between instructions must see each of them
+bool ObserverGroup::break_requested(const Emulator& emulator)
+{
+	bool requested = false;
+	for (ExecutionObserver* observer : observers) {
+		requested |= observer->break_requested(emulator);
+	}
+	return requested;
+}
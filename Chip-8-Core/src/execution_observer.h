@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class Emulator;
+
+// Instrumentation attached to an Emulator with set_observer, for coverage and profiling. Observed emulators execute
+// through Emulator::cycle whatever their backend, so that every event is reported; without an observer the only cost
+// is one test per instruction in the interpreter, and the other backends run unchanged.
+class ExecutionObserver
+{
+public:
+	virtual ~ExecutionObserver() = default;
+
+	// Before executing the instruction at address, cycle_count is the number of instructions before it
+	virtual void on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode) {}
+
+	// Data accessed through I by DRW, Fx33, Fx55 and Fx65, addresses wrap around the address space
+	virtual void on_memory_read(uint16_t address, uint16_t size) {}
+	virtual void on_memory_write(uint16_t address, uint16_t size) {}
+
+	// Checked before each instruction, true stops run_cycles and run_frame with the instruction at pc not executed
+	virtual bool break_requested(const Emulator& emulator) { return false; }
+};
+
+// Forwards every event to several observers, in the order they were added
+class ObserverGroup : public ExecutionObserver
+{
+public:
+	void add(ExecutionObserver* observer);
+	bool empty() const;
+
+	void on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode) override;
+	void on_memory_read(uint16_t address, uint16_t size) override;
+	void on_memory_write(uint16_t address, uint16_t size) override;
+	bool break_requested(const Emulator& emulator) override;
+
+private:
+	std::vector<ExecutionObserver*> observers;
+};
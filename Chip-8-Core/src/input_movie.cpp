@@ -0,0 +1,102 @@
+#include "input_movie.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+InputMovie::InputMovie() :
+	next_event(0),
+	press_cycles{},
+	last_cycle(0)
+{
+}
+
+int InputMovie::load(const std::string& path)
+{
+	std::ifstream input_file(path);
+	if (input_file.fail()) {
+		std::cerr << "Error opening input movie: " << path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string line;
+	int line_number = 0;
+	while (std::getline(input_file, line)) {
+		++line_number;
+
+		size_t comment = line.find('#');
+		if (comment != std::string::npos) {
+			line.erase(comment);
+		}
+
+		std::istringstream line_stream(line);
+		uint64_t frame;
+		unsigned int key;
+		std::string action;
+		if (!(line_stream >> frame)) {
+			continue; // blank line
+		}
+
+		if (!(line_stream >> std::hex >> key) || key > 0xF || !(line_stream >> action) || (action != "down" && action != "up")) {
+			std::cerr << "Invalid input movie event at " << path << ":" << line_number << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		if (!movie_events.empty() && frame < movie_events.back().frame) {
+			std::cerr << "Input movie events are not sorted at " << path << ":" << line_number << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		add(frame, static_cast<uint8_t>(key), action == "down");
+	}
+
+	return EXIT_SUCCESS;
+}
+
+void InputMovie::add(uint64_t frame, uint8_t key, bool pressed)
+{
+	movie_events.push_back({ frame, key, pressed });
+}
+
+bool InputMovie::apply(Emulator& emulator, uint64_t frame)
+{
+	while (next_event < movie_events.size() && movie_events[next_event].frame <= frame) {
+		const Event& event = movie_events[next_event];
+
+		// Applied together, a press and its release in the same frame would never be seen by the program. The release
+		// waits for the cycles of one frame, and the events after it keep their order
+		uint64_t cycle = std::max(emulator.cycle_count, last_cycle);
+		if (!event.pressed) {
+			cycle = std::max(cycle, press_cycles[event.key] + emulator.next_frame_cycles());
+		}
+
+		if (!emulator.queue_input(cycle, event.key, event.pressed)) {
+			std::cerr << "Emulator input queue full at frame " << frame << ", input movie events delayed" << std::endl;
+			return false;
+		}
+		if (event.pressed) {
+			press_cycles[event.key] = cycle;
+		}
+		last_cycle = cycle;
+		++next_event;
+	}
+	return true;
+}
+
+void InputMovie::rewind()
+{
+	next_event = 0;
+	std::fill(std::begin(press_cycles), std::end(press_cycles), 0);
+	last_cycle = 0;
+}
+
+bool InputMovie::finished() const
+{
+	return next_event == movie_events.size();
+}
+
+const std::vector<InputMovie::Event>& InputMovie::events() const
+{
+	return movie_events;
+}
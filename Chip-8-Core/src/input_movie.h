@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "emulator.h"
+
+// Scripted key events for unattended runs. Text format, one event per line, '#' starts a comment:
+//   <frame> <key> <down|up>
+// frame is decimal, key is the CHIP-8 key in hexadecimal (0 to F). Events must be sorted by frame. A key is held for at
+// least one frame: released in the frame it was pressed, it is released at the start of the next one.
+class InputMovie
+{
+public:
+	struct Event
+	{
+		uint64_t frame;
+		uint8_t key;
+		bool pressed;
+	};
+
+	InputMovie();
+
+	int load(const std::string& path);
+	void add(uint64_t frame, uint8_t key, bool pressed);
+
+	// Queue the events of the given frame, to be called before running that frame. false with a message on std::cerr
+	// when the emulator input queue is full, the remaining events are then queued by the next call
+	bool apply(Emulator& emulator, uint64_t frame);
+	void rewind();
+	bool finished() const;
+
+	const std::vector<Event>& events() const;
+
+private:
+	std::vector<Event> movie_events;
+	size_t next_event;
+	uint64_t press_cycles[16];	// cycle at which each key was last pressed
+	uint64_t last_cycle;		// of the last event queued, the queue is in cycle order
+};
@@ -0,0 +1,24 @@
+#include "machine_state.h"
+
+MachineState::MachineState() :
+	memory{ 0 },
+	i(0x200),
+	stack{ 0 },
+	sp(0),
+	v{ 0 },
+	dt(0),
+	st(0),
+	pc(0x200),
+	inputs_mask(0),
+	display{ 0 },
+	draw_flag(false),
+	status(RUNNING),
+	cycle_count(0),
+	draw_count(0),
+	input_queue{},
+	input_head(0),
+	input_tail(0),
+	cycle_budget(0),
+	rng_state(1)
+{
+}
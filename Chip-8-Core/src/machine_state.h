@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Everything an execution backend reads and writes, plain data so that snapshots are a copy
+struct MachineState
+{
+	static const int DISPLAY_WIDTH = 64;
+	static const int DISPLAY_HEIGHT = 32;
+	static const int CPU_FREQUENCY = 700; // Original CPU was around 1MHz ~ 700op/s
+	static const int TIMER_FREQUENCY = 60; // timers and display are refreshed at 60Hz, one frame
+
+	static const int MEMORY_SIZE = 4096;
+	static const uint16_t ADDRESS_MASK = MEMORY_SIZE - 1; // addresses wrap around the 12-bit address space
+	static const int STACK_SIZE = 16;
+	static const int INPUT_QUEUE_SIZE = 64;
+
+	enum Status {
+		RUNNING,
+		WAITING_FOR_INPUT,	// blocked on Fx0A
+		HALTED,				// jumped to itself
+	};
+
+	struct InputEvent
+	{
+		uint64_t cycle;				// value of cycle_count at which the key changes
+		uint8_t key;
+		bool pressed;
+	};
+
+	uint8_t memory[MEMORY_SIZE];	// 0x000 to 0x1FF reserved for interpreter
+	uint16_t i;						// memory address, only lowest 12 bits are used
+	uint16_t stack[STACK_SIZE];		// store the address that the interpreter shoud return to when finished with a subroutine
+	uint8_t sp;						// stack pointer, point to the topmost level of the stack
+	uint8_t v[16];					// V[0xF] is used as a flag by some instructions
+	uint8_t dt;						// delay timer, when non-zero, automatically decremented at a rate of 60Hz
+	uint8_t st;						// sound timer, when non-zero, automatically decremented at a rate of 60Hz
+	uint16_t pc;					// program counter, store the currently executing address
+
+	uint16_t inputs_mask;			// 1 if the key corresponding to the bit index is pressed, 0 otherwise
+	bool display[DISPLAY_WIDTH * DISPLAY_HEIGHT]; // true if pixel is black, false if white
+
+	bool draw_flag;					// set when the display changed, cleared by the host once presented
+	Status status;					// status after the last executed instruction
+	uint64_t cycle_count;			// instructions executed since init
+	uint64_t draw_count;			// sprites drawn since init
+
+	InputEvent input_queue[INPUT_QUEUE_SIZE]; // pending key changes, in cycle order
+	size_t input_head;
+	size_t input_tail;
+	int cycle_budget;				// CPU_FREQUENCY is not a multiple of TIMER_FREQUENCY, carry the remainder between frames
+	uint32_t rng_state;				// per instance so that runs are reproducible and independent across threads
+
+	MachineState();
+};
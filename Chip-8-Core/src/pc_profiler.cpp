@@ -0,0 +1,158 @@
+#include "pc_profiler.h"
+#include "disassembler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	std::ostream& address(std::ostream& out, int value)
+	{
+		return out << "#" << std::uppercase << std::hex << std::setw(3) << std::setfill('0') << value << std::dec << std::setfill(' ');
+	}
+
+	double share(uint64_t part, uint64_t total)
+	{
+		return total ? 100.0 * part / total : 0.0;
+	}
+}
+
+PcProfiler::PcProfiler() :
+	executions{ 0 },
+	costs{ 0 },
+	last_jump(-1)
+{
+}
+
+void PcProfiler::set_cost_model(const std::vector<uint32_t>& model)
+{
+	cost_model = model;
+}
+
+void PcProfiler::on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode)
+{
+	// Jumping to itself halts the program, it is not a loop
+	if (last_jump >= 0 && address < last_jump) {
+		++back_edges[static_cast<uint32_t>(last_jump) << 12 | address];
+	}
+	uint16_t op = opcode >> 12;
+	last_jump = op == 0x1 || op == 0xB ? address : -1;
+
+	int kind = instruction_kind(opcode);
+	++executions[address];
+	costs[address] += cost_model.empty() || kind < 0 ? 1 : cost_model[kind];
+}
+
+uint64_t PcProfiler::total_executions() const
+{
+	uint64_t total = 0;
+	for (uint64_t count : executions) {
+		total += count;
+	}
+	return total;
+}
+
+uint64_t PcProfiler::total_cost() const
+{
+	uint64_t total = 0;
+	for (uint64_t cost : costs) {
+		total += cost;
+	}
+	return total;
+}
+
+std::vector<PcProfiler::HotLoop> PcProfiler::hot_loops() const
+{
+	std::vector<HotLoop> loops;
+	for (const auto& edge : back_edges) {
+		HotLoop loop = { static_cast<uint16_t>(edge.first & MachineState::ADDRESS_MASK), static_cast<uint16_t>(edge.first >> 12), edge.second, 0 };
+		for (int pc = loop.start; pc <= loop.end; ++pc) {
+			loop.cost += costs[pc];
+		}
+		loops.push_back(loop);
+	}
+
+	std::sort(loops.begin(), loops.end(), [](const HotLoop& a, const HotLoop& b) {
+		return a.cost != b.cost ? a.cost > b.cost : a.start < b.start;
+	});
+	return loops;
+}
+
+void PcProfiler::write_report(std::ostream& out, const uint8_t* memory, size_t limit) const
+{
+	uint64_t total = total_cost();
+	out << total_executions() << " instructions, cost " << total << std::endl;
+
+	std::vector<HotLoop> loops = hot_loops();
+	if (!loops.empty()) {
+		out << std::endl << "Hot loops" << std::endl;
+		for (size_t idx = 0; idx < loops.size() && (!limit || idx < limit); ++idx) {
+			const HotLoop& loop = loops[idx];
+			address(out << "  ", loop.start) << "-";
+			address(out, loop.end) << std::setw(12) << loop.iterations << " iterations" << std::setw(14) << loop.cost
+				<< std::fixed << std::setprecision(2) << std::setw(8) << share(loop.cost, total) << " %" << std::endl;
+		}
+	}
+
+	std::vector<uint16_t> addresses;
+	for (int pc = 0; pc < MachineState::MEMORY_SIZE; ++pc) {
+		if (executions[pc]) {
+			addresses.push_back(static_cast<uint16_t>(pc));
+		}
+	}
+	std::stable_sort(addresses.begin(), addresses.end(), [this](uint16_t a, uint16_t b) {
+		return costs[a] > costs[b];
+	});
+
+	out << std::endl << "Address  Opcode    Executions          Cost   Share  Instruction" << std::endl;
+	for (size_t idx = 0; idx < addresses.size() && (!limit || idx < limit); ++idx) {
+		uint16_t pc = addresses[idx];
+		uint16_t opcode = memory[pc] << 8 | memory[(pc + 1) & MachineState::ADDRESS_MASK];
+		address(out, pc) << "     " << std::uppercase << std::hex << std::setw(4) << std::setfill('0') << opcode << std::dec << std::setfill(' ')
+			<< std::setw(14) << executions[pc] << std::setw(14) << costs[pc] << std::fixed << std::setprecision(2)
+			<< std::setw(7) << share(costs[pc], total) << "%  " << disassemble(opcode) << std::endl;
+	}
+}
+
+int load_cost_model(const std::string& path, std::vector<uint32_t>& model)
+{
+	std::ifstream input_file(path);
+	if (input_file.fail()) {
+		std::cerr << "Error opening cost model: " << path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	model.assign(INSTRUCTION_KIND_COUNT, 1);
+
+	std::string line;
+	int line_number = 0;
+	while (std::getline(input_file, line)) {
+		++line_number;
+
+		size_t comment = line.find('#');
+		if (comment != std::string::npos) {
+			line.erase(comment);
+		}
+
+		std::istringstream line_stream(line);
+		std::string name;
+		if (!(line_stream >> name)) {
+			continue; // blank line
+		}
+
+		const char* const* found = std::find_if(INSTRUCTION_NAMES, INSTRUCTION_NAMES + INSTRUCTION_KIND_COUNT, [&](const char* handler) {
+			return name == handler;
+		});
+		uint32_t cost;
+		if (found == INSTRUCTION_NAMES + INSTRUCTION_KIND_COUNT || !(line_stream >> cost)) {
+			std::cerr << "Invalid cost model entry at " << path << ":" << line_number << std::endl;
+			return EXIT_FAILURE;
+		}
+		model[found - INSTRUCTION_NAMES] = cost;
+	}
+
+	return EXIT_SUCCESS;
+}
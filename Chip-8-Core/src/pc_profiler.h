@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "execution_observer.h"
+#include "machine_state.h"
+
+// Flat profile of the emulated program: executions and cost of every address, and the loops closed by backward jumps.
+// Without a cost model every instruction costs 1, with one the cost is the one of its instruction handler.
+class PcProfiler : public ExecutionObserver
+{
+public:
+	struct HotLoop
+	{
+		uint16_t start;				// target of the backward jump
+		uint16_t end;				// address of the backward jump
+		uint64_t iterations;		// times the backward jump was taken
+		uint64_t cost;				// of every instruction in [start, end], called subroutines excluded
+	};
+
+	uint64_t executions[MachineState::MEMORY_SIZE];
+	uint64_t costs[MachineState::MEMORY_SIZE];
+
+	PcProfiler();
+
+	// Cost of each instruction handler indexed like INSTRUCTION_NAMES, empty for no model
+	void set_cost_model(const std::vector<uint32_t>& model);
+
+	void on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode) override;
+
+	uint64_t total_executions() const;
+	uint64_t total_cost() const;
+	std::vector<HotLoop> hot_loops() const; // most expensive first
+
+	// Hot loops then the disassembly of the executed addresses by decreasing cost, limited to the first lines if not 0
+	void write_report(std::ostream& out, const uint8_t* memory, size_t limit) const;
+
+private:
+	std::vector<uint32_t> cost_model;
+	std::unordered_map<uint32_t, uint64_t> back_edges; // jump address << 12 | target address
+	int last_jump;				// address of the previous instruction when it was JP or JP V0, -1 otherwise
+};
+
+// Text format, one handler per line, '#' starts a comment. Handlers not listed cost 1:
+//   <handler name> <cost>
+int load_cost_model(const std::string& path, std::vector<uint32_t>& model);
@@ -0,0 +1,327 @@
+#include "program_analysis.h"
+#include "disassembler.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace
+{
+	const int MAX_JUMP_TABLE_ENTRIES = 128; // V0 is a byte, entries are 2 bytes apart
+
+	struct Instruction
+	{
+		uint16_t opcode;
+		std::vector<uint16_t> successors;
+		int call_target;					// -1 when not a call
+		bool sequential;					// only successor is the next instruction
+	};
+
+	uint16_t read_opcode(const uint8_t* memory, uint16_t address)
+	{
+		return memory[address & MachineState::ADDRESS_MASK] << 8 | memory[(address + 1) & MachineState::ADDRESS_MASK];
+	}
+
+	std::string hex(int value)
+	{
+		std::ostringstream out;
+		out << "#" << std::uppercase << std::hex << std::setw(3) << std::setfill('0') << value;
+		return out.str();
+	}
+
+	class Analyzer
+	{
+	public:
+		Analyzer(const uint8_t* memory, ProgramAnalysis& analysis) :
+			memory(memory),
+			analysis(analysis)
+		{
+		}
+
+		void run(uint16_t entry_point)
+		{
+			std::memset(analysis.flags, 0, sizeof(analysis.flags));
+			analysis.max_call_depth = 0;
+
+			explore(entry_point);
+			build_blocks(entry_point);
+			check_call_depth(entry_point);
+			check_code_writes();
+
+			analysis.instruction_count = instructions.size();
+			std::stable_sort(analysis.issues.begin(), analysis.issues.end(), [](const AnalysisIssue& a, const AnalysisIssue& b) {
+				return a.address < b.address;
+			});
+		}
+
+	private:
+		const uint8_t* memory;
+		ProgramAnalysis& analysis;
+		std::map<uint16_t, Instruction> instructions;
+		std::map<uint16_t, uint16_t> block_of; // instruction address to the start of its block
+
+		void issue(AnalysisIssue::Severity severity, uint16_t address, const std::string& message)
+		{
+			analysis.issues.push_back({ severity, address, message });
+		}
+
+		Instruction decode(uint16_t address)
+		{
+			uint16_t opcode = read_opcode(memory, address);
+			uint16_t next = (address + 2) & MachineState::ADDRESS_MASK;
+			uint16_t nnn = opcode & 0xFFF;
+
+			Instruction instruction = { opcode, {}, -1, false };
+
+			// Zero stops the host loop, like reaching the end of the program
+			if (opcode == 0x0000) {
+				return instruction;
+			}
+
+			if (!valid_opcode(opcode)) {
+				issue(AnalysisIssue::ERROR, address, "invalid opcode " + disassemble(opcode).substr(3));
+				return instruction;
+			}
+
+			switch (opcode >> 12) {
+			case 0x0:
+				if (opcode == 0x00E0) {
+					instruction.successors.push_back(next);
+				}
+				break; // RET leaves the subroutine
+			case 0x1:
+				if (nnn != address) {
+					instruction.successors.push_back(nnn);
+				}
+				break;
+			case 0x2:
+				instruction.call_target = nnn;
+				instruction.successors.push_back(next);
+				break;
+			case 0x3:
+			case 0x4:
+			case 0x5:
+			case 0x9:
+			case 0xE:
+				instruction.successors.push_back(next);
+				instruction.successors.push_back((address + 4) & MachineState::ADDRESS_MASK);
+				break;
+			case 0xB:
+				// Jump tables are a run of JP instructions indexed by an even V0
+				for (int entry = 0; entry < MAX_JUMP_TABLE_ENTRIES; ++entry) {
+					uint16_t entry_address = (nnn + entry * 2) & MachineState::ADDRESS_MASK;
+					if ((read_opcode(memory, entry_address) >> 12) != 0x1) {
+						break;
+					}
+					instruction.successors.push_back(entry_address);
+				}
+				if (instruction.successors.empty()) {
+					issue(AnalysisIssue::WARNING, address, "computed jump to " + hex(nnn) + " + V0 not resolved");
+				}
+				break;
+			default:
+				instruction.successors.push_back(next);
+				break;
+			}
+
+			instruction.sequential = instruction.successors.size() == 1 && instruction.successors[0] == next && instruction.call_target < 0;
+			return instruction;
+		}
+
+		void explore(uint16_t entry_point)
+		{
+			std::vector<uint16_t> pending = { entry_point };
+			while (!pending.empty()) {
+				uint16_t address = pending.back();
+				pending.pop_back();
+				if (instructions.count(address)) {
+					continue;
+				}
+
+				Instruction instruction = decode(address);
+				analysis.flags[address] |= ProgramAnalysis::INSTRUCTION | ProgramAnalysis::CODE;
+				analysis.flags[(address + 1) & MachineState::ADDRESS_MASK] |= ProgramAnalysis::CODE;
+
+				for (uint16_t successor : instruction.successors) {
+					if (!instruction.sequential) {
+						analysis.flags[successor] |= ProgramAnalysis::BRANCH_TARGET;
+					}
+					pending.push_back(successor);
+				}
+				if (instruction.call_target >= 0) {
+					analysis.flags[instruction.call_target] |= ProgramAnalysis::SUBROUTINE;
+					pending.push_back(static_cast<uint16_t>(instruction.call_target));
+				}
+
+				instructions.emplace(address, std::move(instruction));
+			}
+		}
+
+		void build_blocks(uint16_t entry_point)
+		{
+			auto leader = [&](uint16_t address) {
+				return address == entry_point || (analysis.flags[address] & (ProgramAnalysis::BRANCH_TARGET | ProgramAnalysis::SUBROUTINE));
+			};
+
+			for (const auto& entry : instructions) {
+				if (!leader(entry.first)) {
+					continue;
+				}
+
+				BasicBlock block = { entry.first, entry.first, {} };
+				uint16_t address = entry.first;
+				while (true) {
+					const Instruction& instruction = instructions.at(address);
+					block_of[address] = block.start;
+					address = (address + 2) & MachineState::ADDRESS_MASK;
+
+					if (!instruction.sequential || leader(address) || !instructions.count(address)) {
+						block.successors = instruction.successors;
+						break;
+					}
+				}
+				block.end = address;
+				analysis.blocks.push_back(block);
+			}
+
+			for (const auto& entry : instructions) {
+				if (entry.second.call_target >= 0) {
+					analysis.subroutines.push_back(static_cast<uint16_t>(entry.second.call_target));
+				}
+			}
+			std::sort(analysis.subroutines.begin(), analysis.subroutines.end());
+			analysis.subroutines.erase(std::unique(analysis.subroutines.begin(), analysis.subroutines.end()), analysis.subroutines.end());
+		}
+
+		// Calls made by the code reachable from start without entering them
+		std::set<uint16_t> callees(uint16_t start, bool is_entry_point)
+		{
+			std::set<uint16_t> calls;
+			std::set<uint16_t> visited;
+			std::vector<uint16_t> pending = { start };
+			while (!pending.empty()) {
+				uint16_t address = pending.back();
+				pending.pop_back();
+				if (!visited.insert(address).second || !instructions.count(address)) {
+					continue;
+				}
+
+				const Instruction& instruction = instructions.at(address);
+				if (instruction.call_target >= 0) {
+					calls.insert(static_cast<uint16_t>(instruction.call_target));
+				}
+				if (is_entry_point && instruction.opcode == 0x00EE) {
+					issue(AnalysisIssue::ERROR, address, "RET outside of any subroutine, the stack is empty");
+				}
+				pending.insert(pending.end(), instruction.successors.begin(), instruction.successors.end());
+			}
+			return calls;
+		}
+
+		void check_call_depth(uint16_t entry_point)
+		{
+			std::map<uint16_t, std::set<uint16_t>> call_graph;
+			call_graph[entry_point] = callees(entry_point, true);
+			for (uint16_t subroutine : analysis.subroutines) {
+				if (!call_graph.count(subroutine)) {
+					call_graph[subroutine] = callees(subroutine, false);
+				}
+			}
+
+			// Longest call chain, a subroutine on the current chain again means recursion
+			std::map<uint16_t, int> depths;
+			std::set<uint16_t> on_chain;
+			bool recursive = false;
+			std::function<int(uint16_t)> depth = [&](uint16_t function) -> int {
+				auto known = depths.find(function);
+				if (known != depths.end()) {
+					return known->second;
+				}
+				if (!on_chain.insert(function).second) {
+					if (!recursive) {
+						issue(AnalysisIssue::WARNING, function, "recursive subroutine, the stack may overflow");
+					}
+					recursive = true;
+					return 0;
+				}
+
+				int deepest = 0;
+				for (uint16_t callee : call_graph[function]) {
+					deepest = std::max(deepest, 1 + depth(callee));
+				}
+				on_chain.erase(function);
+				depths[function] = deepest;
+				return deepest;
+			};
+
+			int entry_depth = depth(entry_point);
+			analysis.max_call_depth = recursive ? -1 : entry_depth;
+			if (!recursive && entry_depth > MachineState::STACK_SIZE - 1) {
+				issue(AnalysisIssue::ERROR, entry_point, "calls nest " + std::to_string(entry_depth) + " deep, the stack holds "
+					+ std::to_string(MachineState::STACK_SIZE - 1));
+			}
+		}
+
+		// I is only known when set by LD I, addr earlier in the same block
+		void check_code_writes()
+		{
+			for (const auto& entry : instructions) {
+				uint16_t opcode = entry.second.opcode;
+				int length;
+				if ((opcode & 0xF0FF) == 0xF055) {
+					length = ((opcode >> 8) & 0xF) + 1;
+				}
+				else if ((opcode & 0xF0FF) == 0xF033) {
+					length = 3;
+				}
+				else {
+					continue;
+				}
+
+				int i = -1;
+				uint16_t block_start = block_of.count(entry.first) ? block_of[entry.first] : entry.first;
+				for (uint16_t address = entry.first; address != block_start;) {
+					address = (address - 2) & MachineState::ADDRESS_MASK;
+					uint16_t previous = instructions.count(address) ? instructions.at(address).opcode : 0;
+					if ((previous >> 12) == 0xA) {
+						i = previous & 0xFFF;
+						break;
+					}
+					if ((previous & 0xF0FF) == 0xF01E || (previous & 0xF0FF) == 0xF029) {
+						break;
+					}
+				}
+				if (i < 0) {
+					continue;
+				}
+
+				bool writes_code = false;
+				for (int offset = 0; offset < length; ++offset) {
+					uint16_t address = (i + offset) & MachineState::ADDRESS_MASK;
+					analysis.flags[address] |= ProgramAnalysis::WRITTEN;
+					writes_code |= (analysis.flags[address] & ProgramAnalysis::CODE) != 0;
+				}
+				if (writes_code) {
+					issue(AnalysisIssue::WARNING, entry.first, "writes into code at " + hex(i) + ", self-modifying");
+				}
+			}
+		}
+	};
+}
+
+bool ProgramAnalysis::has_errors() const
+{
+	return std::any_of(issues.begin(), issues.end(), [](const AnalysisIssue& issue) {
+		return issue.severity == AnalysisIssue::ERROR;
+	});
+}
+
+ProgramAnalysis analyze_program(const uint8_t* memory, uint16_t entry_point)
+{
+	ProgramAnalysis analysis;
+	Analyzer(memory, analysis).run(entry_point & MachineState::ADDRESS_MASK);
+	return analysis;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "machine_state.h"
+
+// Static control flow analysis of a loaded program: what is reachable from the entry point is code, the rest is data.
+// Skips, calls and jump tables of JP instructions behind Bnnn are followed, values computed at runtime are not.
+struct AnalysisIssue
+{
+	enum Severity {
+		WARNING,	// may be intended, like self-modifying code
+		ERROR,		// the program fails when it gets there
+	};
+
+	Severity severity;
+	uint16_t address;
+	std::string message;
+};
+
+struct BasicBlock
+{
+	uint16_t start;
+	uint16_t end;							// address after the last instruction
+	std::vector<uint16_t> successors;		// calls are not successors, the instruction after them is
+};
+
+struct ProgramAnalysis
+{
+	enum AddressFlag {
+		INSTRUCTION = 1,		// an instruction starts here
+		CODE = 2,				// part of a reachable instruction
+		BRANCH_TARGET = 4,
+		SUBROUTINE = 8,			// target of a call
+		WRITTEN = 16,			// written by Fx33 or Fx55 with a known I
+	};
+
+	uint8_t flags[MachineState::MEMORY_SIZE];
+	std::vector<BasicBlock> blocks;			// sorted by start address
+	std::vector<uint16_t> subroutines;		// sorted
+	size_t instruction_count;
+	int max_call_depth;						// nested calls from the entry point, -1 when a subroutine is recursive
+	std::vector<AnalysisIssue> issues;		// sorted by address
+
+	bool has_errors() const;
+};
+
+// memory is the whole address space with the program loaded, as in MachineState
+ProgramAnalysis analyze_program(const uint8_t* memory, uint16_t entry_point = 0x200);
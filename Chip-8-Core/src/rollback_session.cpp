@@ -0,0 +1,206 @@
+#include "rollback_session.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+	const uint8_t MAGIC[4] = { 'C', '8', 'R', 'B' };
+	const size_t HEADER_SIZE = 13;
+
+	void write_u32(std::vector<uint8_t>& data, uint32_t value)
+	{
+		for (int shift = 0; shift < 32; shift += 8) {
+			data.push_back(static_cast<uint8_t>(value >> shift));
+		}
+	}
+
+	uint32_t read_u32(const uint8_t* data)
+	{
+		return data[0] | data[1] << 8 | data[2] << 16 | static_cast<uint32_t>(data[3]) << 24;
+	}
+}
+
+RollbackSession::RollbackSession(Emulator& emulator) :
+	emulator(emulator),
+	send_delay(0),
+	snapshots_running{ false },
+	peer_acknowledged(0),
+	rollback_frame(UINT64_MAX),
+	program_running(true),
+	session_stats{}
+{
+}
+
+int RollbackSession::open(uint16_t local_port, const std::string& remote_host, uint16_t remote_port)
+{
+	return socket.open_datagram(local_port, remote_host, remote_port);
+}
+
+void RollbackSession::set_send_delay(std::chrono::milliseconds delay)
+{
+	send_delay = delay;
+}
+
+bool RollbackSession::advance(uint16_t keys)
+{
+	receive();
+	roll_back();
+
+	if (!program_running || frame() >= remote_keys.size() + MAX_PREDICTION) {
+		++session_stats.stalls;
+		send();
+		return false;
+	}
+
+	local_keys.push_back(keys);
+	emulate_frame(frame());
+	send();
+	return true;
+}
+
+bool RollbackSession::synchronize()
+{
+	receive();
+	roll_back();
+	send();
+	return remote_keys.size() >= frame() && peer_acknowledged >= local_keys.size();
+}
+
+uint64_t RollbackSession::frame() const
+{
+	return used_keys.size();
+}
+
+uint64_t RollbackSession::confirmed_frames() const
+{
+	return remote_keys.size();
+}
+
+bool RollbackSession::running() const
+{
+	return program_running;
+}
+
+const RollbackSession::Stats& RollbackSession::stats() const
+{
+	return session_stats;
+}
+
+// The remote player most likely keeps holding the same keys
+uint16_t RollbackSession::predicted_keys(uint64_t frame) const
+{
+	if (frame < remote_keys.size()) {
+		return remote_keys[frame];
+	}
+	return remote_keys.empty() ? 0 : remote_keys.back();
+}
+
+void RollbackSession::emulate_frame(uint64_t frame)
+{
+	snapshots[frame % SNAPSHOT_COUNT] = emulator.save_state();
+	snapshots_running[frame % SNAPSHOT_COUNT] = program_running;
+
+	uint16_t remote = predicted_keys(frame);
+	if (frame < used_keys.size()) {
+		used_keys[frame] = remote;
+	}
+	else {
+		used_keys.push_back(remote);
+	}
+
+	// Frames after the end of the program are kept as empty frames, so that both sides count the same frames
+	if (program_running) {
+		emulator.inputs_mask = local_keys[frame] | remote;
+		uint64_t start_cycle = emulator.cycle_count;
+		uint64_t start_draw = emulator.draw_count;
+		program_running = emulator.run_frame();
+		session_stats.instructions += emulator.cycle_count - start_cycle;
+		session_stats.draws += emulator.draw_count - start_draw;
+	}
+}
+
+void RollbackSession::receive()
+{
+	uint8_t data[HEADER_SIZE + 2 * 255];
+	while (socket.readable(0)) {
+		// Errors report datagrams the peer was not there to receive yet, they are sent again anyway
+		long size = socket.receive(data, sizeof(data));
+		if (size < static_cast<long>(HEADER_SIZE) || !std::equal(std::begin(MAGIC), std::end(MAGIC), data)) {
+			continue;
+		}
+
+		uint64_t first_frame = read_u32(data + 4);
+		uint64_t acknowledged = read_u32(data + 8);
+		int count = data[12];
+		if (size < static_cast<long>(HEADER_SIZE + 2 * count)) {
+			continue;
+		}
+		++session_stats.packets_received;
+
+		peer_acknowledged = std::max(peer_acknowledged, std::min<uint64_t>(acknowledged, local_keys.size()));
+
+		// Only the frames following those already received, the older ones are duplicates and the gaps are sent again
+		for (int idx = 0; idx < count && first_frame + idx <= remote_keys.size(); ++idx) {
+			uint64_t keys_frame = first_frame + idx;
+			if (keys_frame < remote_keys.size()) {
+				continue;
+			}
+
+			uint16_t keys = static_cast<uint16_t>(data[HEADER_SIZE + 2 * idx] | data[HEADER_SIZE + 2 * idx + 1] << 8);
+			remote_keys.push_back(keys);
+			if (keys_frame < used_keys.size() && used_keys[keys_frame] != keys) {
+				rollback_frame = std::min(rollback_frame, keys_frame);
+			}
+		}
+	}
+}
+
+// Never deeper than MAX_PREDICTION frames, the snapshot of the first mispredicted frame is still there
+void RollbackSession::roll_back()
+{
+	if (rollback_frame == UINT64_MAX) {
+		return;
+	}
+
+	uint64_t current_frame = frame();
+	emulator.rewind_state(snapshots[rollback_frame % SNAPSHOT_COUNT]);
+	program_running = snapshots_running[rollback_frame % SNAPSHOT_COUNT];
+	for (uint64_t resimulated = rollback_frame; resimulated < current_frame; ++resimulated) {
+		emulate_frame(resimulated);
+	}
+
+	++session_stats.rollbacks;
+	session_stats.resimulated_frames += current_frame - rollback_frame;
+	session_stats.max_rollback = std::max(session_stats.max_rollback, current_frame - rollback_frame);
+	rollback_frame = UINT64_MAX;
+}
+
+void RollbackSession::send()
+{
+	uint64_t first_frame = std::max<uint64_t>(peer_acknowledged, local_keys.size() > MAX_PACKET_FRAMES ? local_keys.size() - MAX_PACKET_FRAMES : 0);
+	size_t count = local_keys.size() - first_frame;
+
+	PendingPacket packet{ std::chrono::steady_clock::now() + send_delay, {} };
+	packet.data.assign(std::begin(MAGIC), std::end(MAGIC));
+	write_u32(packet.data, static_cast<uint32_t>(first_frame));
+	write_u32(packet.data, static_cast<uint32_t>(remote_keys.size()));
+	packet.data.push_back(static_cast<uint8_t>(count));
+	for (uint64_t keys_frame = first_frame; keys_frame < local_keys.size(); ++keys_frame) {
+		packet.data.push_back(static_cast<uint8_t>(local_keys[keys_frame]));
+		packet.data.push_back(static_cast<uint8_t>(local_keys[keys_frame] >> 8));
+	}
+
+	pending_packets.push_back(std::move(packet));
+	flush_packets();
+}
+
+void RollbackSession::flush_packets()
+{
+	auto now = std::chrono::steady_clock::now();
+	while (!pending_packets.empty() && pending_packets.front().due <= now) {
+		const std::vector<uint8_t>& data = pending_packets.front().data;
+		socket.send(data.data(), data.size());
+		++session_stats.packets_sent;
+		pending_packets.pop_front();
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "emulator.h"
+#include "machine_state.h"
+#include "socket.h"
+
+// Two-player netplay with rollback over UDP. Both sides emulate the same program and press keys of the same keypad,
+// the keys of each frame are those of both players. Every frame is emulated right away: the remote keys not received
+// yet are predicted to be the last ones received. When a prediction turns out wrong, the machine is rewound to the
+// snapshot of that frame and the frames since are emulated again with the right keys, within the same host frame.
+//
+// Each datagram carries every local key mask the peer did not acknowledge yet, so lost datagrams need no timeout:
+//   "C8RB" first_frame:u32 acknowledged:u32 count:u8 keys:u16[count], little endian
+// acknowledged is the number of consecutive remote frames received, the next frame expected from the peer.
+class RollbackSession
+{
+public:
+	static const int MAX_PREDICTION = 8;	// frames emulated ahead of the last remote keys before stalling
+	static const int MAX_PACKET_FRAMES = 64;
+
+	struct Stats
+	{
+		uint64_t rollbacks;
+		uint64_t resimulated_frames;
+		uint64_t max_rollback;				// frames emulated again by the deepest rollback
+		uint64_t stalls;					// calls to advance that waited for the peer
+		uint64_t packets_sent;
+		uint64_t packets_received;
+		uint64_t instructions;				// executed, those of the frames emulated again included
+		uint64_t draws;						// DRW executed, likewise
+	};
+
+	RollbackSession(Emulator& emulator);
+
+	// The emulator must hold the same program, state and seed on both sides before the first frame
+	int open(uint16_t local_port, const std::string& remote_host, uint16_t remote_port);
+
+	// Simulated one-way latency of the datagrams sent, loopback has none
+	void set_send_delay(std::chrono::milliseconds delay);
+
+	// Exchange keys, roll back on a misprediction, then emulate the next frame with the local keys pressed. false
+	// without emulating when MAX_PREDICTION frames ahead of the peer, the call is to be repeated
+	bool advance(uint16_t keys);
+
+	// Exchange keys and roll back without emulating a new frame. true once every emulated frame used the real remote
+	// keys and the peer acknowledged all the local ones: both machines are then in the same state
+	bool synchronize();
+
+	uint64_t frame() const;				// frames emulated
+	uint64_t confirmed_frames() const;	// consecutive frames whose remote keys were received
+	bool running() const;				// false once the program ended
+	const Stats& stats() const;
+
+private:
+	static const int SNAPSHOT_COUNT = MAX_PREDICTION + 2;
+
+	struct PendingPacket
+	{
+		std::chrono::steady_clock::time_point due;
+		std::vector<uint8_t> data;
+	};
+
+	Emulator& emulator;
+	Socket socket;
+	std::chrono::milliseconds send_delay;
+	std::deque<PendingPacket> pending_packets;
+
+	std::vector<uint16_t> local_keys;	// indexed by frame
+	std::vector<uint16_t> remote_keys;	// received, indexed by frame
+	std::vector<uint16_t> used_keys;	// remote keys each emulated frame ran with, real or predicted
+	MachineState snapshots[SNAPSHOT_COUNT]; // state at the start of the frame, indexed by frame % SNAPSHOT_COUNT
+	bool snapshots_running[SNAPSHOT_COUNT];
+	uint64_t peer_acknowledged;			// local frames received by the peer
+	uint64_t rollback_frame;			// first frame emulated with a wrong prediction, UINT64_MAX if none
+	bool program_running;
+	Stats session_stats;
+
+	uint16_t predicted_keys(uint64_t frame) const;
+	void emulate_frame(uint64_t frame);
+	void receive();
+	void roll_back();
+	void send();
+	void flush_packets();
+};
@@ -0,0 +1,39 @@
+#include "run_ahead.h"
+#include <algorithm>
+#include <exception>
+
+RunAhead::RunAhead(int frames) :
+	ahead_frames(std::clamp(frames, 0, MAX_FRAMES))
+{
+}
+
+int RunAhead::frames() const
+{
+	return ahead_frames;
+}
+
+void RunAhead::run(Emulator& emulator)
+{
+	snapshot = emulator.save_state();
+
+	// Observers see each frame once, when it is really emulated
+	ExecutionObserver* observer = emulator.execution_observer();
+	emulator.set_observer(nullptr);
+
+	try {
+		bool running = true;
+		for (int frame = 0; running && frame < ahead_frames && !emulator.idle(); ++frame) {
+			running = emulator.run_frame();
+		}
+	}
+	catch (const std::exception&) {
+		// The fault is reported when the machine really gets there, the frames before it are presented meanwhile
+	}
+
+	emulator.set_observer(observer);
+}
+
+void RunAhead::rewind(Emulator& emulator)
+{
+	emulator.rewind_state(snapshot);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "emulator.h"
+#include "machine_state.h"
+
+// Run-ahead: the frame presented is computed a few frames ahead of the emulated machine, with the keys currently
+// pressed, then thrown away. The frames of input lag built into most programs are hidden, as long as the keys do not
+// change during the frames run ahead.
+class RunAhead
+{
+public:
+	static const int MAX_FRAMES = 8;
+
+	RunAhead(int frames);
+
+	int frames() const;
+
+	// Snapshot the emulator and run the frames ahead, without observer. The emulator then holds the state to present
+	void run(Emulator& emulator);
+
+	// Back to the snapshot taken by run, the emulated machine continues from there
+	void rewind(Emulator& emulator);
+
+private:
+	int ahead_frames;
+	MachineState snapshot;
+};
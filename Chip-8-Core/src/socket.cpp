@@ -0,0 +1,193 @@
+#include "socket.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+namespace
+{
+	const uintptr_t INVALID_HANDLE = INVALID_SOCKET;
+
+	// Winsock has to be started once per process before any other call
+	bool start_sockets()
+	{
+		static bool started = [] {
+			WSADATA data;
+			return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+		}();
+		return started;
+	}
+
+	void close_handle(uintptr_t handle)
+	{
+		closesocket(handle);
+	}
+}
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+	const int INVALID_HANDLE = -1;
+
+	bool start_sockets()
+	{
+		return true;
+	}
+
+	void close_handle(int handle)
+	{
+		::close(handle);
+	}
+}
+#endif
+
+Socket::Socket() :
+	handle(INVALID_HANDLE)
+{
+}
+
+Socket::Socket(Handle handle) :
+	handle(handle)
+{
+}
+
+Socket::~Socket()
+{
+	close();
+}
+
+Socket::Socket(Socket&& other) noexcept :
+	handle(other.handle)
+{
+	other.handle = INVALID_HANDLE;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+	if (this != &other) {
+		close();
+		handle = other.handle;
+		other.handle = INVALID_HANDLE;
+	}
+	return *this;
+}
+
+bool Socket::valid() const
+{
+	return handle != INVALID_HANDLE;
+}
+
+void Socket::close()
+{
+	if (valid()) {
+		close_handle(handle);
+		handle = INVALID_HANDLE;
+	}
+}
+
+int Socket::listen(uint16_t port, bool loopback_only)
+{
+	close();
+	if (!start_sockets()) {
+		return EXIT_FAILURE;
+	}
+
+	handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (!valid()) {
+		return EXIT_FAILURE;
+	}
+
+	// Restarting the process must not wait for the previous connections to time out
+	int reuse = 1;
+	setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(loopback_only ? INADDR_LOOPBACK : INADDR_ANY);
+
+	if (bind(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(handle, 8) != 0) {
+		close();
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+Socket Socket::accept()
+{
+	return Socket(::accept(handle, nullptr, nullptr));
+}
+
+int Socket::open_datagram(uint16_t local_port, const std::string& remote_host, uint16_t remote_port)
+{
+	close();
+	if (!start_sockets()) {
+		return EXIT_FAILURE;
+	}
+
+	sockaddr_in remote_address;
+	std::memset(&remote_address, 0, sizeof(remote_address));
+	remote_address.sin_family = AF_INET;
+	remote_address.sin_port = htons(remote_port);
+	if (inet_pton(AF_INET, remote_host.c_str(), &remote_address.sin_addr) != 1) {
+		return EXIT_FAILURE;
+	}
+
+	handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (!valid()) {
+		return EXIT_FAILURE;
+	}
+
+	sockaddr_in local_address;
+	std::memset(&local_address, 0, sizeof(local_address));
+	local_address.sin_family = AF_INET;
+	local_address.sin_port = htons(local_port);
+	local_address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	// Connected, datagrams from any other address are filtered out by the system
+	if (bind(handle, reinterpret_cast<const sockaddr*>(&local_address), sizeof(local_address)) != 0
+		|| connect(handle, reinterpret_cast<const sockaddr*>(&remote_address), sizeof(remote_address)) != 0) {
+		close();
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+bool Socket::readable(int timeout_ms) const
+{
+#if defined(_WIN32)
+	WSAPOLLFD descriptor = { handle, POLLRDNORM, 0 };
+	return WSAPoll(&descriptor, 1, timeout_ms) > 0;
+#else
+	pollfd descriptor = { handle, POLLIN, 0 };
+	return poll(&descriptor, 1, timeout_ms) > 0;
+#endif
+}
+
+long Socket::send(const void* data, size_t size)
+{
+#if defined(_WIN32)
+	return ::send(handle, static_cast<const char*>(data), static_cast<int>(size), 0);
+#else
+	return static_cast<long>(::send(handle, data, size, MSG_NOSIGNAL));
+#endif
+}
+
+long Socket::receive(void* data, size_t size)
+{
+#if defined(_WIN32)
+	return ::recv(handle, static_cast<char*>(data), static_cast<int>(size), 0);
+#else
+	return static_cast<long>(::recv(handle, data, size, 0));
+#endif
+}
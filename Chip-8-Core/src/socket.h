@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Minimal IPv4 socket over Winsock or POSIX sockets, TCP for the local tooling endpoints and UDP for netplay.
+// Blocking, except that readable waits with a timeout so that callers can poll or check whether to stop.
+class Socket
+{
+public:
+	Socket();
+	~Socket();
+
+	Socket(Socket&& other) noexcept;
+	Socket& operator=(Socket&& other) noexcept;
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+
+	bool valid() const;
+	void close();
+
+	// Listen on the port of 127.0.0.1, or of every interface when loopback_only is false
+	int listen(uint16_t port, bool loopback_only);
+	Socket accept();
+
+	// UDP socket bound to the local port of every interface, sending to and receiving from the remote address only
+	int open_datagram(uint16_t local_port, const std::string& remote_host, uint16_t remote_port);
+
+	// Wait up to timeout_ms for data, or for a connection on a listening socket
+	bool readable(int timeout_ms) const;
+
+	// Bytes transferred, 0 when the peer closed the connection and -1 on error. One whole datagram on UDP sockets,
+	// where errors also report the previous datagrams that could not be delivered
+	long send(const void* data, size_t size);
+	long receive(void* data, size_t size);
+
+private:
+#if defined(_WIN32)
+	typedef uintptr_t Handle;
+#else
+	typedef int Handle;
+#endif
+
+	Handle handle;
+
+	explicit Socket(Handle handle);
+};
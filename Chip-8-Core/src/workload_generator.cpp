@@ -0,0 +1,263 @@
+#include "workload_generator.h"
+#include "emulator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace
+{
+	const char* WORKLOAD_NAMES[WORKLOAD_COUNT] = { "alu", "draw", "call", "self_modify", "computed_jump", "timer_poll" };
+
+	// Fixed layout so that blocks can reference the shared routine and data before they are written
+	const uint16_t PROGRAM_START = 0x200;
+	const uint16_t RECURSION_START = PROGRAM_START + 2;	// after the jump over the shared area
+	const uint16_t SPRITE_START = RECURSION_START + 8;
+	const int SPRITE_SIZE = 15;
+	const uint16_t BLOCKS_START = SPRITE_START + SPRITE_SIZE + 1; // instructions must stay 2-byte aligned
+
+	// Largest block is a computed jump over 8 cases, so that the next block always fits before the closing jump
+	const int MAX_BLOCK_SIZE = 2 * (4 + 3 + 8 + 8 * 2);
+
+	// Registers used by blocks for their own bookkeeping, the random instructions only use V0 to VC
+	const uint8_t COUNTER = 0xD;
+	const uint8_t SCRATCH = 0xE;
+
+	class ProgramWriter
+	{
+	public:
+		ProgramWriter(uint32_t seed) :
+			rng_state(seed ? seed : 0x2545F491)
+		{
+		}
+
+		uint16_t address() const
+		{
+			return static_cast<uint16_t>(PROGRAM_START + bytes.size());
+		}
+
+		void emit(uint16_t opcode)
+		{
+			bytes.push_back(static_cast<uint8_t>(opcode >> 8));
+			bytes.push_back(static_cast<uint8_t>(opcode & 0xFF));
+		}
+
+		void patch(uint16_t address, uint16_t opcode)
+		{
+			bytes[address - PROGRAM_START] = static_cast<uint8_t>(opcode >> 8);
+			bytes[address - PROGRAM_START + 1] = static_cast<uint8_t>(opcode & 0xFF);
+		}
+
+		// xorshift32, same generator as the emulator
+		uint32_t random(uint32_t bound)
+		{
+			rng_state ^= rng_state << 13;
+			rng_state ^= rng_state >> 17;
+			rng_state ^= rng_state << 5;
+			return rng_state % bound;
+		}
+
+		uint16_t random_register()
+		{
+			return static_cast<uint16_t>(random(COUNTER));
+		}
+
+		std::vector<uint8_t> bytes;
+
+	private:
+		uint32_t rng_state;
+	};
+
+	uint16_t random_alu_opcode(ProgramWriter& writer)
+	{
+		const uint16_t OPERATIONS[] = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE };
+
+		uint16_t x = writer.random_register();
+		uint16_t y = writer.random_register();
+		switch (writer.random(4)) {
+		case 0:
+			return 0x7000 | x << 8 | writer.random(0x100); // ADD Vx, byte
+		case 1:
+			return 0xC000 | x << 8 | writer.random(0x100); // RND Vx, byte
+		default:
+			return 0x8000 | x << 8 | y << 4 | OPERATIONS[writer.random(sizeof(OPERATIONS) / sizeof(OPERATIONS[0]))];
+		}
+	}
+
+	// LD VD, loop_count; body...; ADD VD, -1; SE VD, 0; JP body
+	template <typename Body>
+	void emit_loop(ProgramWriter& writer, int loop_count, Body body)
+	{
+		writer.emit(0x6000 | COUNTER << 8 | loop_count);
+		uint16_t loop_start = writer.address();
+		body();
+		writer.emit(0x7000 | COUNTER << 8 | 0xFF);
+		writer.emit(0x3000 | COUNTER << 8);
+		writer.emit(0x1000 | loop_start);
+	}
+
+	void emit_block(ProgramWriter& writer, Workload workload, const WorkloadOptions& options)
+	{
+		switch (workload) {
+		case ALU:
+			emit_loop(writer, options.loop_count, [&] {
+				uint32_t length = 4 + writer.random(13);
+				for (uint32_t idx = 0; idx < length; ++idx) {
+					writer.emit(random_alu_opcode(writer));
+				}
+			});
+			break;
+		case DRAW:
+			writer.emit(0xA000 | SPRITE_START);
+			emit_loop(writer, options.loop_count, [&] {
+				// Offset by a register the other blocks compute, mixed with them the display depends on their results
+				writer.emit(0xC03F); // RND V0, 63
+				writer.emit(0xC11F); // RND V1, 31
+				writer.emit(0x8004 | writer.random_register() << 4); // ADD V0, Vr
+				writer.emit(0xD010 | (1 + writer.random(SPRITE_SIZE)));
+			});
+			break;
+		case CALL:
+			writer.emit(0x6000 | COUNTER << 8 | options.call_depth);
+			writer.emit(0x2000 | RECURSION_START);
+			break;
+		case SELF_MODIFY:
+			emit_loop(writer, options.loop_count, [&] {
+				// Store "ADD Vr, byte" over the instruction right after LD [I], V1
+				uint16_t target = writer.address() + 8;
+				uint16_t r = writer.random_register();
+				writer.emit(0x6070 | r);
+				writer.emit(0xC1FF);
+				writer.emit(0xA000 | target);
+				writer.emit(0xF155);
+				writer.emit(0x7000 | r << 8 | writer.random(0x100));
+			});
+			break;
+		case COMPUTED_JUMP:
+			emit_loop(writer, options.loop_count, [&] {
+				// RND V0, n - 1; ADD V0, V0; JP V0, table; table: JP case_0 ... JP case_n-1; case_k: ALU; JP end
+				uint16_t cases = static_cast<uint16_t>(2 << writer.random(3));
+				writer.emit(0xC000 | (cases - 1));
+				writer.emit(0x8004);
+				uint16_t table = writer.address() + 2;
+				writer.emit(0xB000 | table);
+				for (uint16_t idx = 0; idx < cases; ++idx) {
+					writer.emit(0x1000); // patched once the case addresses are known
+				}
+
+				std::vector<uint16_t> case_ends;
+				for (uint16_t idx = 0; idx < cases; ++idx) {
+					writer.patch(table + idx * 2, 0x1000 | writer.address());
+					writer.emit(random_alu_opcode(writer));
+					case_ends.push_back(writer.address());
+					writer.emit(0x1000);
+				}
+				for (uint16_t case_end : case_ends) {
+					writer.patch(case_end, 0x1000 | writer.address());
+				}
+			});
+			break;
+		case TIMER_POLL: {
+			// LD VE, ticks; LD DT, VE; wait: LD VE, DT; SE VE, 0; JP wait
+			writer.emit(0x6000 | SCRATCH << 8 | (1 + writer.random(3)));
+			writer.emit(0xF015 | SCRATCH << 8);
+			uint16_t wait = writer.address();
+			writer.emit(0xF007 | SCRATCH << 8);
+			writer.emit(0x3000 | SCRATCH << 8);
+			writer.emit(0x1000 | wait);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+WorkloadOptions::WorkloadOptions() :
+	size(1024),
+	seed(1),
+	loop_count(16),
+	call_depth(Emulator::STACK_SIZE - 1),
+	mix{ 0 }
+{
+}
+
+const char* workload_name(Workload workload)
+{
+	return workload < WORKLOAD_COUNT ? WORKLOAD_NAMES[workload] : "unknown";
+}
+
+bool parse_workload(const std::string& name, Workload& workload)
+{
+	for (int idx = 0; idx < WORKLOAD_COUNT; ++idx) {
+		if (name == WORKLOAD_NAMES[idx]) {
+			workload = static_cast<Workload>(idx);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool parse_workload_mix(const std::string& mix, unsigned int weights[WORKLOAD_COUNT])
+{
+	std::fill(weights, weights + WORKLOAD_COUNT, 0);
+
+	std::istringstream mix_stream(mix);
+	std::string entry;
+	while (std::getline(mix_stream, entry, ',')) {
+		size_t separator = entry.find('=');
+		Workload workload;
+		if (!parse_workload(entry.substr(0, separator), workload)) {
+			return false;
+		}
+		weights[workload] = separator == std::string::npos ? 1 : std::strtoul(entry.c_str() + separator + 1, nullptr, 0);
+	}
+
+	return true;
+}
+
+std::vector<uint8_t> generate_workload(const WorkloadOptions& options)
+{
+	WorkloadOptions clamped = options;
+	clamped.loop_count = std::clamp(options.loop_count, 1, 255);
+	// call_addr never uses stack[0], one level less than the stack size
+	clamped.call_depth = std::clamp(options.call_depth, 1, Emulator::STACK_SIZE - 1);
+
+	unsigned int weights[WORKLOAD_COUNT];
+	unsigned int total_weight = 0;
+	for (int idx = 0; idx < WORKLOAD_COUNT; ++idx) {
+		total_weight += options.mix[idx];
+	}
+	for (int idx = 0; idx < WORKLOAD_COUNT; ++idx) {
+		weights[idx] = total_weight ? options.mix[idx] : 1;
+	}
+	total_weight = total_weight ? total_weight : static_cast<unsigned int>(WORKLOAD_COUNT);
+
+	ProgramWriter writer(options.seed);
+
+	writer.emit(0x1000 | BLOCKS_START);
+
+	// recursion: ADD VD, -1; SE VD, 0; CALL recursion; RET
+	writer.emit(0x7000 | COUNTER << 8 | 0xFF);
+	writer.emit(0x3000 | COUNTER << 8);
+	writer.emit(0x2000 | RECURSION_START);
+	writer.emit(0x00EE);
+
+	for (int idx = 0; idx < SPRITE_SIZE; ++idx) {
+		writer.bytes.push_back(static_cast<uint8_t>(writer.random(0x100)));
+	}
+	writer.bytes.push_back(0);
+
+	const size_t size_limit = std::min<size_t>(options.size, Emulator::MEMORY_SIZE - PROGRAM_START - MAX_BLOCK_SIZE - 2);
+	do {
+		uint32_t pick = writer.random(total_weight);
+		int workload = 0;
+		while (pick >= weights[workload]) {
+			pick -= weights[workload];
+			++workload;
+		}
+		emit_block(writer, static_cast<Workload>(workload), clamped);
+	} while (writer.bytes.size() < size_limit);
+
+	writer.emit(0x1000 | BLOCKS_START);
+	return writer.bytes;
+}
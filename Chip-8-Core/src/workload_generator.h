@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Synthetic programs stressing one execution path each, real programs rarely hit them on purpose
+enum Workload {
+	ALU,			// register arithmetic loops
+	DRAW,			// sprite storms at random positions
+	CALL,			// call_addr/ret recursion as deep as the stack allows
+	SELF_MODIFY,	// instructions rewritten through Fx55 right before being executed
+	COMPUTED_JUMP,	// jump tables through jp_v0_addr
+	TIMER_POLL,		// idle loops polling the delay timer
+	WORKLOAD_COUNT,
+};
+
+struct WorkloadOptions
+{
+	size_t size;					// approximate program size in bytes, capped by the available memory
+	uint32_t seed;					// same options and seed generate the same program
+	int loop_count;					// iterations of each looping block, 1 to 255
+	int call_depth;					// nested calls of each CALL block, 1 to Emulator::STACK_SIZE - 1
+	unsigned int mix[WORKLOAD_COUNT]; // relative weight of each block kind, all zero means equal weights
+
+	WorkloadOptions();
+};
+
+const char* workload_name(Workload workload);
+bool parse_workload(const std::string& name, Workload& workload);
+
+// "alu=4,draw=1" style weights, kinds not listed get a weight of zero
+bool parse_workload_mix(const std::string& mix, unsigned int weights[WORKLOAD_COUNT]);
+
+// The program is an endless loop over randomly chosen blocks, it never halts nor waits for a key
+std::vector<uint8_t> generate_workload(const WorkloadOptions& options);
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Pre-rasterised 5x7 bitmap font covering printable ASCII from ' ' to '_'
+class FontAtlas
+{
+public:
+	static const int GLYPH_WIDTH = 5;
+	static const int GLYPH_HEIGHT = 7;
+	static const char FIRST_CHAR = ' ';
+	static const char LAST_CHAR = '_';
+
+	FontAtlas(int scale);
+
+	int cell_width() const;
+	int cell_height() const;
+
+	// Copy the glyph of c into a luminance bitmap, dst points to the top-left pixel of the cell
+	void blit(char c, uint8_t* dst, int dst_pitch) const;
+
+private:
+	int scale;
+	std::vector<uint8_t> pixels; // one cell_width() x cell_height() block per glyph
+};
@@ -0,0 +1,101 @@
+#include "frame_pacer.h"
+#include "phase_trace.h"
+#include <algorithm>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+FramePacer::FramePacer(int frequency) :
+	base_frame_duration(std::chrono::nanoseconds(1s) / frequency),
+	frame_duration(base_frame_duration),
+	spin_threshold(2ms),
+	next_deadline(Clock::now()),
+	speed_multiplier(1.0),
+	turbo_enabled(false),
+	dropped_frame_count(0)
+{
+}
+
+void FramePacer::set_speed(double multiplier)
+{
+	if (multiplier <= 0.0) {
+		return;
+	}
+
+	speed_multiplier = multiplier;
+	frame_duration = std::chrono::nanoseconds(static_cast<long long>(base_frame_duration.count() / multiplier));
+}
+
+double FramePacer::speed() const
+{
+	return speed_multiplier;
+}
+
+void FramePacer::set_turbo(bool enabled)
+{
+	turbo_enabled = enabled;
+	reset();
+}
+
+bool FramePacer::turbo() const
+{
+	return turbo_enabled;
+}
+
+void FramePacer::reset()
+{
+	next_deadline = Clock::now();
+}
+
+std::chrono::nanoseconds FramePacer::wait()
+{
+	if (turbo_enabled) {
+		return 0ns;
+	}
+
+	PHASE_TRACE_SCOPE("frame_pacer.wait");
+	next_deadline += frame_duration;
+
+	auto now = Clock::now();
+	if (now >= next_deadline) {
+		std::chrono::nanoseconds late = now - next_deadline;
+		frame_lateness.record(late);
+		if (late > frame_duration * MAX_LAG_FRAMES) {
+			dropped_frame_count += late / frame_duration;
+			next_deadline = now;
+		}
+		return late;
+	}
+
+	// Sleep through most of the wait, then spin until the deadline
+	if (next_deadline - now > spin_threshold) {
+		auto wake_time = next_deadline - spin_threshold;
+		std::this_thread::sleep_until(wake_time);
+
+		// Widen the spin window when the scheduler oversleeps, shrink it back slowly otherwise
+		auto oversleep = Clock::now() - wake_time;
+		if (oversleep > spin_threshold) {
+			spin_threshold = std::min<std::chrono::nanoseconds>(oversleep + 500us, frame_duration);
+		}
+		else if (spin_threshold > 1ms) {
+			spin_threshold -= 10us;
+		}
+	}
+
+	while ((now = Clock::now()) < next_deadline) {
+		std::this_thread::yield();
+	}
+
+	frame_lateness.record(now - next_deadline);
+	return now - next_deadline;
+}
+
+const LatencyHistogram& FramePacer::lateness() const
+{
+	return frame_lateness;
+}
+
+uint64_t FramePacer::dropped_frames() const
+{
+	return dropped_frame_count;
+}
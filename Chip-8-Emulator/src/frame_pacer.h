@@ -0,0 +1,39 @@
+#pragma once
+#include "latency_histogram.h"
+#include <chrono>
+
+// Paces whole frames against absolute steady clock deadlines, so oversleeping one frame is caught up on the next
+class FramePacer
+{
+public:
+	FramePacer(int frequency);
+
+	void set_speed(double multiplier);
+	double speed() const;
+	void set_turbo(bool enabled);
+	bool turbo() const;
+
+	// Restart the schedule from now, e.g. after the loop was paused
+	void reset();
+	// Block until the deadline of the next frame, returns how late it started
+	std::chrono::nanoseconds wait();
+
+	// How late each frame started compared to its deadline
+	const LatencyHistogram& lateness() const;
+	// Frames skipped because the loop fell more than MAX_LAG_FRAMES behind
+	uint64_t dropped_frames() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	static const int MAX_LAG_FRAMES = 4; // beyond this the lost frames are dropped instead of run in a burst
+
+	std::chrono::nanoseconds base_frame_duration;
+	std::chrono::nanoseconds frame_duration;
+	std::chrono::nanoseconds spin_threshold;	// the last part of the wait is spun, sleeping is not precise enough
+	Clock::time_point next_deadline;
+	double speed_multiplier;
+	bool turbo_enabled;
+	LatencyHistogram frame_lateness;
+	uint64_t dropped_frame_count;
+};
@@ -0,0 +1,40 @@
+#include "frame_skipper.h"
+#include <algorithm>
+#include <cmath>
+
+FrameSkipper::FrameSkipper(int refresh_rate) :
+	refresh_rate(std::max(refresh_rate, 1)),
+	skip_interval(1),
+	frame_index(0),
+	measured_frames(0),
+	measure_start(Clock::now())
+{
+}
+
+bool FrameSkipper::next_frame()
+{
+	++measured_frames;
+	auto now = Clock::now();
+	std::chrono::duration<double> elapsed = now - measure_start;
+	if (elapsed >= MEASURE_PERIOD) {
+		double frame_rate = measured_frames / elapsed.count();
+		skip_interval = std::max(1, static_cast<int>(std::lround(frame_rate / refresh_rate)));
+		measured_frames = 0;
+		measure_start = now;
+	}
+
+	return ++frame_index % skip_interval == 0;
+}
+
+int FrameSkipper::interval() const
+{
+	return skip_interval;
+}
+
+void FrameSkipper::reset()
+{
+	skip_interval = 1;
+	frame_index = 0;
+	measured_frames = 0;
+	measure_start = Clock::now();
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Presents only every Nth emulated frame when they are produced faster than the monitor refreshes, in turbo or above
+// normal speed. N follows the measured emulated frame rate, so the display keeps refreshing at the monitor rate.
+class FrameSkipper
+{
+public:
+	FrameSkipper(int refresh_rate);
+
+	// Once per emulated frame, true when this frame may be presented
+	bool next_frame();
+	int interval() const;
+
+	// Back to presenting every frame, e.g. when leaving turbo
+	void reset();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr std::chrono::milliseconds MEASURE_PERIOD{ 250 };
+
+	int refresh_rate;
+	int skip_interval;
+	uint64_t frame_index;
+	uint64_t measured_frames;
+	Clock::time_point measure_start;
+};
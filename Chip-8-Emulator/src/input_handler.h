@@ -1,67 +1,181 @@
 #pragma once
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
-#include <unordered_map>
 #include <cstdint>
+#include <optional>
+#include "emulator.h"
+#include "phase_trace.h"
+#include "spsc_queue.h"
 
-static uint16_t inputs_mask;
+struct KeyEvent
+{
+	std::chrono::steady_clock::time_point timestamp;
+	uint8_t key;
+	bool pressed;
+};
+
+static SpscQueue<KeyEvent, 256> key_events;
+
+static bool heatmap_toggle_requested;
+static bool pause_toggle_requested;
+static bool step_requested;
+static bool turbo_toggle_requested;
 
-#if _DEBUG
-static bool debug_mode;
-static bool step;
+#if CHIP8_TRACING
+static bool trace_dump_requested;
 #endif
 
-// Keys are mapped using Qwerty layout
+// Keys are mapped using Qwerty layout, indexed by GLFW key code, -1 if the key is not mapped
+static std::array<int8_t, GLFW_KEY_LAST + 1> make_keyboard_map()
+{
+	std::array<int8_t, GLFW_KEY_LAST + 1> keyboard_map;
+	keyboard_map.fill(-1);
+
+	keyboard_map[GLFW_KEY_1] = 0x1;
+	keyboard_map[GLFW_KEY_2] = 0x2;
+	keyboard_map[GLFW_KEY_3] = 0x3;
+	keyboard_map[GLFW_KEY_4] = 0xC;
+	keyboard_map[GLFW_KEY_Q] = 0x4;
+	keyboard_map[GLFW_KEY_W] = 0x5;
+	keyboard_map[GLFW_KEY_E] = 0x6;
+	keyboard_map[GLFW_KEY_R] = 0xD;
+	keyboard_map[GLFW_KEY_A] = 0x7;
+	keyboard_map[GLFW_KEY_S] = 0x8;
+	keyboard_map[GLFW_KEY_D] = 0x9;
+	keyboard_map[GLFW_KEY_F] = 0xE;
+	keyboard_map[GLFW_KEY_Z] = 0xA;
+	keyboard_map[GLFW_KEY_X] = 0x0;
+	keyboard_map[GLFW_KEY_C] = 0xB;
+	keyboard_map[GLFW_KEY_V] = 0xF;
+
+	return keyboard_map;
+}
+
+static const std::array<int8_t, GLFW_KEY_LAST + 1> keyboard_map = make_keyboard_map();
+
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-	static const std::unordered_map<int, uint8_t> keyboard_map = {
-		{'1', 0x1},
-		{'2', 0x2},
-		{'3', 0x3},
-		{'4', 0xC},
-		{'q', 0x4}, {'Q', 0x4},
-		{'w', 0x5}, {'W', 0x5},
-		{'e', 0x6}, {'E', 0x6},
-		{'r', 0xD}, {'R', 0xD},
-		{'a', 0x7}, {'A', 0x7},
-		{'s', 0x8}, {'S', 0x8},
-		{'d', 0x9}, {'D', 0x9},
-		{'f', 0xE}, {'F', 0xE},
-		{'z', 0xA}, {'Z', 0xA},
-		{'x', 0x0}, {'X', 0x0},
-		{'c', 0xB}, {'C', 0xB},
-		{'v', 0xF}, {'V', 0xF}
-	};
-
-	auto it = keyboard_map.find(key);
-	if (it != keyboard_map.end()) {
-		uint8_t mapped_key = it->second;
-
-		switch (action) {
-		case GLFW_PRESS:
-			inputs_mask |= (1 << mapped_key);
-			break;
-		case GLFW_RELEASE:
-			inputs_mask &= ~(1 << mapped_key);
-			break;
+	if (key < 0 || key > GLFW_KEY_LAST || action == GLFW_REPEAT) {
+		return;
+	}
+
+	int8_t mapped_key = keyboard_map[key];
+	if (mapped_key >= 0) {
+		KeyEvent event{ std::chrono::steady_clock::now(), static_cast<uint8_t>(mapped_key), action == GLFW_PRESS };
+		if (!key_events.push(event)) {
+			std::cerr << "Input queue full, key event dropped" << std::endl;
 		}
 
 		return;
 	}
 
-#if _DEBUG
 	if (action == GLFW_PRESS) {
 		switch (key) {
-		case 'b':
-		case 'B':
-			debug_mode = !debug_mode;
+		case GLFW_KEY_H:
+			heatmap_toggle_requested = true;
 			break;
-		case 'n':
-		case 'N':
-			step = true;
+		case GLFW_KEY_B:
+			pause_toggle_requested = true;
+			break;
+		case GLFW_KEY_N:
+			step_requested = true;
+			break;
+		case GLFW_KEY_TAB:
+			turbo_toggle_requested = true;
 			break;
 		}
 	}
+
+#if CHIP8_TRACING
+	if (action == GLFW_PRESS && key == GLFW_KEY_F9) {
+		trace_dump_requested = true;
+	}
 #endif
 }
 
+// Netplay exchanges the keys of whole frames instead: the keys held now, plus those pressed during the previous frame
+// so that taps shorter than a frame are not lost. Returns how many events were collected.
+static int collect_key_events(uint16_t& keys)
+{
+	static uint16_t held_keys;
+
+	uint16_t pressed_keys = 0;
+	int collected = 0;
+	KeyEvent event;
+	while (key_events.pop(event)) {
+		if (event.pressed) {
+			held_keys |= 1 << event.key;
+			pressed_keys |= 1 << event.key;
+		}
+		else {
+			held_keys &= ~(1 << event.key);
+		}
+		++collected;
+	}
+
+	keys = held_keys | pressed_keys;
+	return collected;
+}
+
+// Start of the period whose key events the next dispatch_key_events maps into the frame about to run
+static std::chrono::steady_clock::time_point key_frame_start = std::chrono::steady_clock::now();
+
+// The host slept until an event, what arrived meanwhile is not spread over the sleep
+static void restart_key_frame()
+{
+	key_frame_start = std::chrono::steady_clock::now();
+}
+
+// Hand the key events received since the previous call to the emulator, right before running the next frame. Each one
+// is scheduled in that frame at the cycle matching its arrival time within the period since the previous call, so
+// taps shorter than a frame keep their timing. A blocked emulator gets them at once, the key that wakes it must not
+// wait for the end of the frame. Events the emulator input queue has no room for stay in key_events until the next
+// call. first_press is set to the arrival time of the first press dispatched when not set yet. Returns how many
+// events were dispatched.
+static int dispatch_key_events(Emulator& emulator, std::optional<std::chrono::steady_clock::time_point>& first_press)
+{
+	const uint64_t frame_cycles = emulator.next_frame_cycles();
+
+	static uint64_t press_cycles[16];
+	static uint64_t last_cycle;
+
+	auto now = std::chrono::steady_clock::now();
+	auto frame_duration = now - key_frame_start;
+	bool blocked = emulator.blocked();
+
+	int dispatched = 0;
+	KeyEvent event;
+	while (key_events.peek(event)) {
+		double offset = 0.0;
+		if (!blocked && frame_duration.count() > 0) {
+			offset = std::clamp(static_cast<double>((event.timestamp - key_frame_start).count()) / frame_duration.count(), 0.0, 1.0);
+		}
+
+		// Events keep their order, and a press lasts at least one frame so that programs polling once per frame see it.
+		// The last cycle of the frame is frame_cycles - 1
+		uint64_t cycle = std::max(emulator.cycle_count + static_cast<uint64_t>(offset * (frame_cycles - 1)), last_cycle);
+		if (!event.pressed) {
+			cycle = std::max(cycle, press_cycles[event.key] + frame_cycles);
+		}
+
+		if (!emulator.queue_input(cycle, event.key, event.pressed)) {
+			std::cerr << "Emulator input queue full, key events delayed" << std::endl;
+			break;
+		}
+		key_events.pop(event);
+		if (event.pressed) {
+			press_cycles[event.key] = cycle;
+			if (!first_press) {
+				first_press = event.timestamp;
+			}
+		}
+		last_cycle = cycle;
+		++dispatched;
+	}
+
+	key_frame_start = now;
+	return dispatched;
+}
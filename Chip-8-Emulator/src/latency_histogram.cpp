@@ -0,0 +1,118 @@
+#include "latency_histogram.h"
+#include <iomanip>
+
+LatencyHistogram::LatencyHistogram()
+{
+	clear();
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency)
+{
+	uint64_t ns = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+
+	++buckets[bucket_index(ns)];
+	++total;
+	if (ns > max_ns) {
+		max_ns = ns;
+	}
+}
+
+void LatencyHistogram::clear()
+{
+	for (uint32_t& bucket : buckets) {
+		bucket = 0;
+	}
+	total = 0;
+	max_ns = 0;
+}
+
+uint64_t LatencyHistogram::count() const
+{
+	return total;
+}
+
+// Upper bound of the bucket holding the given percentile, clamped to the exact maximum
+std::chrono::nanoseconds LatencyHistogram::percentile(double percent) const
+{
+	if (total == 0) {
+		return std::chrono::nanoseconds(0);
+	}
+
+	uint64_t rank = static_cast<uint64_t>(percent / 100.0 * total + 0.5);
+	if (rank == 0) {
+		rank = 1;
+	}
+
+	uint64_t seen = 0;
+	for (int index = 0; index < BUCKET_COUNT; ++index) {
+		seen += buckets[index];
+		if (seen >= rank) {
+			uint64_t upper_bound = bucket_upper_bound(index);
+			return std::chrono::nanoseconds(upper_bound < max_ns ? upper_bound : max_ns);
+		}
+	}
+
+	return max();
+}
+
+std::chrono::nanoseconds LatencyHistogram::max() const
+{
+	return std::chrono::nanoseconds(max_ns);
+}
+
+void LatencyHistogram::dump(std::ostream& out) const
+{
+	auto to_us = [](std::chrono::nanoseconds ns) { return ns.count() / 1000.0; };
+
+	out << std::fixed << std::setprecision(1);
+	out << "samples = " << total
+		<< "; p50 = " << to_us(percentile(50.0)) << "us"
+		<< "; p90 = " << to_us(percentile(90.0)) << "us"
+		<< "; p99 = " << to_us(percentile(99.0)) << "us"
+		<< "; p99.9 = " << to_us(percentile(99.9)) << "us"
+		<< "; max = " << to_us(max()) << "us" << std::endl;
+
+	for (int index = 0; index < BUCKET_COUNT; ++index) {
+		if (buckets[index]) {
+			out << "  [" << to_us(std::chrono::nanoseconds(bucket_lower_bound(index))) << "us, "
+				<< to_us(std::chrono::nanoseconds(bucket_upper_bound(index))) << "us] " << buckets[index] << std::endl;
+		}
+	}
+
+	out << std::defaultfloat;
+}
+
+int LatencyHistogram::bucket_index(uint64_t ns)
+{
+	if (ns < SUB_BUCKET_COUNT) {
+		return static_cast<int>(ns);
+	}
+
+	int msb = 0;
+	while (ns >> (msb + 1)) {
+		++msb;
+	}
+
+	int shift = msb - SUB_BUCKET_BITS;
+	return ((shift + 1) << SUB_BUCKET_BITS) + static_cast<int>((ns >> shift) & (SUB_BUCKET_COUNT - 1));
+}
+
+uint64_t LatencyHistogram::bucket_lower_bound(int index)
+{
+	if (index < SUB_BUCKET_COUNT) {
+		return index;
+	}
+
+	int shift = (index >> SUB_BUCKET_BITS) - 1;
+	return static_cast<uint64_t>(SUB_BUCKET_COUNT + (index & (SUB_BUCKET_COUNT - 1))) << shift;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(int index)
+{
+	if (index < SUB_BUCKET_COUNT) {
+		return index;
+	}
+
+	int shift = (index >> SUB_BUCKET_BITS) - 1;
+	return bucket_lower_bound(index) + (static_cast<uint64_t>(1) << shift) - 1;
+}
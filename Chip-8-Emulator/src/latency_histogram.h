@@ -0,0 +1,33 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Log-linear histogram of durations, 8 buckets per power of two so any value is kept within 12.5%
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	void record(std::chrono::nanoseconds latency);
+	void clear();
+
+	uint64_t count() const;
+	std::chrono::nanoseconds percentile(double percent) const;
+	std::chrono::nanoseconds max() const;
+
+	void dump(std::ostream& out) const;
+
+private:
+	static const int SUB_BUCKET_BITS = 3;
+	static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	static const int BUCKET_COUNT = 64 * SUB_BUCKET_COUNT;
+
+	uint32_t buckets[BUCKET_COUNT];
+	uint64_t total;
+	uint64_t max_ns;
+
+	static int bucket_index(uint64_t ns);
+	static uint64_t bucket_lower_bound(int index);
+	static uint64_t bucket_upper_bound(int index);
+};
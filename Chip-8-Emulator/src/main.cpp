@@ -1,21 +1,144 @@
+﻿#include "debugger.h"
 #include "emulator.h"
 #include "renderer.h"
-#include "frequency_lock.h"
+#include "frame_pacer.h"
+#include "frame_skipper.h"
 #include "input_handler.h"
+#include "memory_heatmap.h"
+#include "metrics_exporter.h"
+#include "metrics_registry.h"
+#include "phase_trace.h"
+#include "realtime.h"
+#include "rollback_session.h"
+#include "run_ahead.h"
+#include <cstring>
 #include <iostream>
+#include <optional>
 
 int main(int argc, char* argv[])
 {
 	std::string program_path = "resources/programs/Chip8 emulator Logo [Garstyciuks].ch8";
+	bool low_jitter = false;
+	int low_jitter_core = 0;
+	bool pacing_report = false;
+	bool heatmap_shown = false;
+	double speed = 1.0;
+	bool turbo = false;
+	int run_ahead_frames = 0;
+	std::string netplay_spec;
+	std::string backend_name = "interpreter";
+	int metrics_port = 0;
+	std::string metrics_path;
+	Debugger debugger;
+#if CHIP8_TRACING
+	std::string trace_path = "chip8_trace.json";
+#endif
+
+	for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+		std::string arg = argv[arg_idx];
+		if (arg == "--low-jitter") {
+			low_jitter = true;
+		}
+		else if (arg.rfind("--low-jitter=", 0) == 0) {
+			low_jitter = true;
+			low_jitter_core = std::atoi(arg.c_str() + std::strlen("--low-jitter="));
+		}
+		else if (arg == "--pacing-report") {
+			pacing_report = true;
+		}
+		else if (arg == "--heatmap") {
+			heatmap_shown = true;
+		}
+		else if (arg == "--turbo") {
+			turbo = true;
+		}
+		else if (arg.rfind("--run-ahead=", 0) == 0) {
+			run_ahead_frames = std::atoi(arg.c_str() + std::strlen("--run-ahead="));
+			if (run_ahead_frames < 0 || run_ahead_frames > RunAhead::MAX_FRAMES) {
+				std::cerr << "Run-ahead must be between 0 and " << RunAhead::MAX_FRAMES << " frames: " << arg << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg.rfind("--netplay=", 0) == 0) {
+			netplay_spec = arg.substr(std::strlen("--netplay="));
+		}
+		else if (arg.rfind("--speed=", 0) == 0) {
+			speed = std::atof(arg.c_str() + std::strlen("--speed="));
+			if (speed <= 0.0) {
+				std::cerr << "Invalid speed multiplier: " << arg << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg.rfind("--backend=", 0) == 0) {
+			backend_name = arg.substr(std::strlen("--backend="));
+		}
+		else if (arg.rfind("--metrics-port=", 0) == 0) {
+			metrics_port = std::atoi(arg.c_str() + std::strlen("--metrics-port="));
+		}
+		else if (arg.rfind("--metrics-file=", 0) == 0) {
+			metrics_path = arg.substr(std::strlen("--metrics-file="));
+		}
+		else if (arg.rfind("--break=", 0) == 0) {
+			if (debugger.add_breakpoint(arg.substr(std::strlen("--break="))) == EXIT_FAILURE) {
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg.rfind("--watch=", 0) == 0) {
+			if (debugger.add_watchpoint(arg.substr(std::strlen("--watch="))) == EXIT_FAILURE) {
+				return EXIT_FAILURE;
+			}
+		}
+#if CHIP8_TRACING
+		else if (arg.rfind("--trace=", 0) == 0) {
+			trace_path = arg.substr(std::strlen("--trace="));
+		}
+#endif
+		else {
+			program_path = arg;
+		}
+	}
+
+	std::unique_ptr<ExecutionBackend> backend = make_backend(backend_name);
+	if (!backend) {
+		std::cerr << "Unknown execution backend: " << backend_name << std::endl;
+		return EXIT_FAILURE;
+	}
 
 	Emulator emulator;
+	emulator.set_backend(std::move(backend));
 	if (emulator.init(program_path) == EXIT_FAILURE) {
 		std::cerr << "Failed to initialize emulator" << std::endl;
 		return EXIT_FAILURE;
 	}
 
+	// Both players must run the same program from the same machine, the seed included
+	RollbackSession netplay_session(emulator);
+	bool netplay = !netplay_spec.empty();
+	uint16_t netplay_keys = 0;
+	if (netplay) {
+		size_t host_start = netplay_spec.find(':');
+		size_t host_end = netplay_spec.rfind(':');
+		if (host_start == std::string::npos || host_start == host_end) {
+			std::cerr << "Expected --netplay=LOCAL_PORT:HOST:REMOTE_PORT" << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (!debugger.empty()) {
+			std::cerr << "Breakpoints and watchpoints are not available in netplay, rollbacks emulate frames again" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		uint16_t local_port = static_cast<uint16_t>(std::atoi(netplay_spec.c_str()));
+		std::string remote_host = netplay_spec.substr(host_start + 1, host_end - host_start - 1);
+		uint16_t remote_port = static_cast<uint16_t>(std::atoi(netplay_spec.c_str() + host_end + 1));
+		if (netplay_session.open(local_port, remote_host, remote_port) == EXIT_FAILURE) {
+			std::cerr << "Cannot open UDP port " << local_port << " to " << remote_host << ":" << remote_port << std::endl;
+			return EXIT_FAILURE;
+		}
+		emulator.seed(0);
+	}
+
 	Renderer renderer("Chip-8 Emulator", Emulator::DISPLAY_WIDTH, Emulator::DISPLAY_HEIGHT, 16, 16);
-	if (renderer.init(argc, argv) == EXIT_FAILURE) {
+	if (renderer.init() == EXIT_FAILURE) {
 		std::cerr << "Failed to initialize renderer" << std::endl;
 		return EXIT_FAILURE;
 	}
@@ -27,30 +150,209 @@ int main(int argc, char* argv[])
 
 	renderer.set_key_callback(key_callback);
 
+	// Opt-in, the emulation runs on the main thread which also owns the window
+	if (low_jitter && !enable_low_jitter(low_jitter_core)) {
+		std::cerr << "Low jitter mode partially applied" << std::endl;
+	}
+
+	FramePacer frame_pacer(Emulator::TIMER_FREQUENCY);
+	frame_pacer.set_speed(speed);
+	frame_pacer.set_turbo(turbo);
+	renderer.set_pacing_stats(&frame_pacer.lateness());
+
+	// Above the monitor rate, in turbo or at a high speed, the frames in between are emulated but not presented. The
+	// skipper measures the rate of the whole loop: whenever the emulated rate can exceed the monitor rate, presenting
+	// must not wait for vsync or the loop would be held down to the monitor rate and the skipper would never kick in
+	FrameSkipper frame_skipper(renderer.refresh_rate());
+	const auto apply_vsync = [&]() {
+		const bool above_refresh_rate = frame_pacer.speed() * Emulator::TIMER_FREQUENCY > renderer.refresh_rate();
+		renderer.set_vsync(!frame_pacer.turbo() && !above_refresh_rate);
+	};
+	apply_vsync();
+
+	// Updated every frame whether exported or not, relaxed atomic additions cost next to nothing
+	MetricsRegistry metrics;
+	MetricCounter& instructions_metric = metrics.counter("chip8_instructions_total", "Emulated instructions executed");
+	MetricCounter& frames_metric = metrics.counter("chip8_frames_total", "Emulated frames run");
+	MetricCounter& draws_metric = metrics.counter("chip8_draws_total", "DRW instructions executed");
+	MetricCounter& presents_metric = metrics.counter("chip8_presents_total", "Frames presented on screen");
+	MetricCounter& dropped_metric = metrics.counter("chip8_dropped_frames_total", "Frames skipped to catch up after falling behind");
+	MetricCounter& inputs_metric = metrics.counter("chip8_input_events_total", "Key events handed to the emulator");
+	MetricHistogram& lateness_metric = metrics.histogram("chip8_frame_lateness_seconds", "Lateness of each frame start compared to its deadline",
+		{ 0.0001, 0.00025, 0.0005, 0.001, 0.002, 0.004, 0.008, 0.016, 0.033 });
+
+	MetricsExporter metrics_exporter(metrics);
+	if (metrics_port > 0 && metrics_exporter.serve(static_cast<uint16_t>(metrics_port)) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	if (!metrics_path.empty() && metrics_exporter.write_periodically(metrics_path, std::chrono::seconds(1)) == EXIT_FAILURE) {
+		std::cerr << "Metrics can be served on a port or written to a file, not both" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// Observed emulators run the interpreter whatever the backend, only while the heatmap is shown or the debugger has
+	// breakpoints or watchpoints. Pausing and stepping do not need the debugger to observe the emulator.
+	MemoryHeatmap heatmap;
+	ObserverGroup observers;
+	auto attach_observers = [&] {
+		observers = ObserverGroup();
+		if (heatmap_shown) {
+			observers.add(&heatmap);
+		}
+		if (!debugger.empty()) {
+			observers.add(&debugger);
+		}
+		emulator.set_observer(observers.empty() ? nullptr : &observers);
+		renderer.set_heatmap(heatmap_shown ? &heatmap : nullptr);
+	};
+	attach_observers();
+
+	RunAhead run_ahead(run_ahead_frames);
+
+	uint64_t last_cycle_count = netplay ? 0 : emulator.cycle_count;
+	uint64_t last_draw_count = netplay ? 0 : emulator.draw_count;
+	uint64_t last_dropped_frames = 0;
+
+	// From the arrival of a key press to the end of the first present after the frame it was applied in
+	LatencyHistogram input_latency;
+	std::optional<std::chrono::steady_clock::time_point> pending_press;
+
 	bool running = true;
 	while (running && !renderer.should_close()) {
-		FrequencyLock loop_frequency_setter(Emulator::CPU_FREQUENCY);
+		// Right before the frame, the keys received since the previous one are applied in it
+		renderer.poll_events();
+		inputs_metric.add(netplay ? collect_key_events(netplay_keys) : dispatch_key_events(emulator, pending_press));
 
-#if _DEBUG
-		if (!debug_mode || debug_mode && step)
-#endif
-		{
-			running = emulator.cycle();
-			if (emulator.draw_flag) {
-				renderer.draw(emulator);
+		bool presentable = true;
+		if (debugger.stopped()) {
+			// A step outside of the rollback session would desynchronize netplay
+			if (step_requested && !netplay) {
+				PHASE_TRACE_SCOPE("emulator.cycle");
+				running = emulator.cycle();
+				std::cout << "Stepped to #" << std::hex << emulator.pc << std::dec << std::endl;
+			}
+		}
+		else if (netplay) {
+			// Stalls while too far ahead of the other player, the frame is retried next time
+			PHASE_TRACE_SCOPE("emulator.cycle");
+			if (netplay_session.advance(netplay_keys)) {
+				frames_metric.add();
+				presentable = frame_skipper.next_frame();
 			}
+			running = netplay_session.running();
+		}
+		else {
+			PHASE_TRACE_SCOPE("emulator.cycle");
+			running = emulator.run_frame();
+			frames_metric.add();
+			presentable = frame_skipper.next_frame();
 
-#if _DEBUG
-			step = false;
-#endif
+			if (debugger.stopped()) {
+				std::cout << "Stopped at #" << std::hex << emulator.pc << std::dec << ": " << debugger.stop_description() << std::endl;
 			}
+		}
+		step_requested = false;
 
-		renderer.poll_events();
-		emulator.inputs_mask = inputs_mask;
+		if (heatmap_shown) {
+			heatmap.decay();
+		}
+
+		// Only for the frames that may be presented, and not while the debugger shows the real machine
+		bool ahead = run_ahead.frames() > 0 && presentable && running && !debugger.stopped();
+		if (ahead) {
+			PHASE_TRACE_SCOPE("run_ahead");
+			run_ahead.run(emulator);
+		}
+
+		// draw_flag stays set through skipped frames, the next presented frame shows their changes
+		bool presented = false;
+		if ((emulator.draw_flag && presentable) || renderer.debug_refresh_due()) {
+			renderer.draw(emulator);
+			presented = true;
+			presents_metric.add();
+
+			if (pending_press) {
+				input_latency.record(std::chrono::steady_clock::now() - *pending_press);
+				pending_press.reset();
+			}
+		}
+
+		if (ahead) {
+			run_ahead.rewind(emulator);
+		}
+		if (presented) {
+			emulator.draw_flag = false;
+		}
+
+		if (heatmap_toggle_requested) {
+			heatmap_shown = !heatmap_shown;
+			attach_observers();
+			heatmap_toggle_requested = false;
 		}
 
+		if (turbo_toggle_requested) {
+			frame_pacer.set_turbo(!frame_pacer.turbo());
+			apply_vsync();
+			frame_skipper.reset();
+			std::cout << (frame_pacer.turbo() ? "Turbo on" : "Turbo off") << std::endl;
+			turbo_toggle_requested = false;
+		}
+
+		if (pause_toggle_requested) {
+			if (debugger.stopped()) {
+				debugger.resume(emulator);
+			}
+			else {
+				debugger.pause();
+				std::cout << "Paused at #" << std::hex << emulator.pc << std::dec << std::endl;
+			}
+			pause_toggle_requested = false;
+		}
+
+		// A rollback rewinds cycle_count and draw_count with the rest of the machine, the session counts the frames
+		// it emulates again instead
+		uint64_t cycle_count = netplay ? netplay_session.stats().instructions : emulator.cycle_count;
+		uint64_t draw_count = netplay ? netplay_session.stats().draws : emulator.draw_count;
+		instructions_metric.add(cycle_count - last_cycle_count);
+		draws_metric.add(draw_count - last_draw_count);
+		last_cycle_count = cycle_count;
+		last_draw_count = draw_count;
+
+#if CHIP8_TRACING
+		if (trace_dump_requested) {
+			write_phase_trace(trace_path);
+			trace_dump_requested = false;
+		}
+#endif
+
+		// Nothing can happen until a key is pressed or the window is closed, sleep until then. In netplay the key may
+		// come from the other player
+		if (!netplay && emulator.idle()) {
+			renderer.wait_events();
+			restart_key_frame();
+			frame_pacer.reset();
+		}
+		// In turbo the next frame starts right away, there is no deadline to be late for
+		else if (!frame_pacer.turbo()) {
+			lateness_metric.observe(std::chrono::duration<double>(frame_pacer.wait()).count());
+			dropped_metric.add(frame_pacer.dropped_frames() - last_dropped_frames);
+			last_dropped_frames = frame_pacer.dropped_frames();
+		}
+	}
+
 	renderer.close();
+	metrics_exporter.stop();
 
-	return EXIT_SUCCESS;
+#if CHIP8_TRACING
+	write_phase_trace(trace_path);
+#endif
+
+	if (pacing_report) {
+		std::cout << "Frame lateness: ";
+		frame_pacer.lateness().dump(std::cout);
+		std::cout << "Key press to present latency: ";
+		input_latency.dump(std::cout);
 	}
 
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+#include "memory_heatmap.h"
+
+static_assert(MemoryHeatmap::SIZE * MemoryHeatmap::SIZE == Emulator::MEMORY_SIZE, "one heatmap pixel per byte of memory");
+
+MemoryHeatmap::MemoryHeatmap() :
+	heat{ 0 }
+{
+}
+
+void MemoryHeatmap::on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode)
+{
+	warm(address, 2, EXECUTE);
+}
+
+void MemoryHeatmap::on_memory_read(uint16_t address, uint16_t size)
+{
+	warm(address, size, READ);
+}
+
+void MemoryHeatmap::on_memory_write(uint16_t address, uint16_t size)
+{
+	warm(address, size, WRITE);
+}
+
+void MemoryHeatmap::decay()
+{
+	for (uint8_t& value : heat) {
+		value -= value >> DECAY_SHIFT;
+		// Values below 1 << DECAY_SHIFT never reach 0 by shifting alone
+		if (value < (1 << DECAY_SHIFT)) {
+			value = value ? value - 1 : 0;
+		}
+	}
+}
+
+const uint8_t* MemoryHeatmap::pixels() const
+{
+	return heat;
+}
+
+// Saturating, a byte accessed every instruction stays at full intensity
+void MemoryHeatmap::warm(uint16_t address, uint16_t size, Channel channel)
+{
+	for (uint16_t offset = 0; offset < size; ++offset) {
+		uint8_t& value = heat[((address + offset) & Emulator::ADDRESS_MASK) * 3 + channel];
+		value = value > 255 - HEAT_PER_ACCESS ? 255 : value + HEAT_PER_ACCESS;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include "emulator.h"
+#include "execution_observer.h"
+
+// Recent memory traffic per byte for the debug panel, as 64x64 RGB pixels: red for writes, green for reads and blue
+// for executed instructions. Every access heats its bytes up, and decay cools them down once per frame.
+class MemoryHeatmap : public ExecutionObserver
+{
+public:
+	static const int SIZE = 64; // pixels per side, one per byte of memory
+
+	MemoryHeatmap();
+
+	void on_instruction(const Emulator& emulator, uint16_t address, uint16_t opcode) override;
+	void on_memory_read(uint16_t address, uint16_t size) override;
+	void on_memory_write(uint16_t address, uint16_t size) override;
+
+	void decay();
+
+	// SIZE * SIZE * 3 bytes, address 0 at the top-left corner then row by row
+	const uint8_t* pixels() const;
+
+private:
+	static const int HEAT_PER_ACCESS = 96;
+	static const int DECAY_SHIFT = 3; // lose 1/8 of the heat per frame, about half after 5 frames
+
+	enum Channel {
+		WRITE,
+		READ,
+		EXECUTE,
+	};
+
+	uint8_t heat[SIZE * SIZE * 3];
+
+	void warm(uint16_t address, uint16_t size, Channel channel);
+};
@@ -0,0 +1,114 @@
+#include "metrics_exporter.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+MetricsExporter::MetricsExporter(const MetricsRegistry& registry) :
+	registry(registry),
+	stopping(false)
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+	stop();
+}
+
+int MetricsExporter::serve(uint16_t port)
+{
+	if (thread.joinable() || listener.listen(port, true) == EXIT_FAILURE) {
+		std::cerr << "Cannot serve metrics on port " << port << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	thread = std::thread(&MetricsExporter::serve_loop, this);
+	return EXIT_SUCCESS;
+}
+
+int MetricsExporter::write_periodically(const std::string& path, std::chrono::milliseconds interval)
+{
+	if (thread.joinable()) {
+		return EXIT_FAILURE;
+	}
+
+	thread = std::thread(&MetricsExporter::write_loop, this, path, interval);
+	return EXIT_SUCCESS;
+}
+
+void MetricsExporter::stop()
+{
+	stopping = true;
+	if (thread.joinable()) {
+		thread.join();
+	}
+	listener.close();
+}
+
+// One request per connection, HTTP/1.0 without keep-alive is all scrapers need
+void MetricsExporter::serve_loop()
+{
+	while (!stopping) {
+		if (!listener.readable(POLL_INTERVAL_MS)) {
+			continue;
+		}
+
+		Socket connection = listener.accept();
+		if (!connection.valid()) {
+			continue;
+		}
+
+		// The request itself does not matter, read until the end of its headers or give up
+		std::string request;
+		char buffer[1024];
+		while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192 && connection.readable(POLL_INTERVAL_MS)) {
+			long received = connection.receive(buffer, sizeof(buffer));
+			if (received <= 0) {
+				break;
+			}
+			request.append(buffer, received);
+		}
+
+		std::ostringstream body;
+		registry.write_prometheus(body);
+		std::string content = body.str();
+
+		std::ostringstream response;
+		response << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " << content.size() << "\r\n\r\n" << content;
+		std::string data = response.str();
+		for (size_t sent = 0; sent < data.size();) {
+			long written = connection.send(data.data() + sent, data.size() - sent);
+			if (written <= 0) {
+				break;
+			}
+			sent += written;
+		}
+	}
+}
+
+void MetricsExporter::write_loop(std::string path, std::chrono::milliseconds interval)
+{
+	std::string temporary_path = path + ".tmp";
+	auto next_write = std::chrono::steady_clock::now();
+
+	while (!stopping) {
+		if (std::chrono::steady_clock::now() < next_write) {
+			std::this_thread::sleep_for(std::min<std::chrono::milliseconds>(interval, std::chrono::milliseconds(POLL_INTERVAL_MS)));
+			continue;
+		}
+		next_write += interval;
+
+		{
+			std::ofstream output_file(temporary_path);
+			registry.write_prometheus(output_file);
+			if (output_file.fail()) {
+				continue;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporary_path, path, error);
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "metrics_registry.h"
+#include "socket.h"
+
+// Publishes a registry from a background thread, either as a Prometheus endpoint on a local port or as a file
+// rewritten periodically for node exporters' textfile collector. Only one of them per exporter.
+class MetricsExporter
+{
+public:
+	explicit MetricsExporter(const MetricsRegistry& registry);
+	~MetricsExporter();
+
+	MetricsExporter(const MetricsExporter&) = delete;
+	MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+	// Any path answers with the metrics, the endpoint only listens on 127.0.0.1
+	int serve(uint16_t port);
+	// Written to a temporary file then renamed, readers never see a partial file
+	int write_periodically(const std::string& path, std::chrono::milliseconds interval);
+	void stop();
+
+private:
+	static const int POLL_INTERVAL_MS = 200; // how long stop may wait for the thread
+
+	const MetricsRegistry& registry;
+	std::thread thread;
+	std::atomic<bool> stopping;
+	Socket listener;
+
+	void serve_loop();
+	void write_loop(std::string path, std::chrono::milliseconds interval);
+};
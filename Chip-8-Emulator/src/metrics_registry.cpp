@@ -0,0 +1,100 @@
+#include "metrics_registry.h"
+
+MetricCounter::MetricCounter() :
+	total(0)
+{
+}
+
+void MetricCounter::add(uint64_t amount)
+{
+	total.fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t MetricCounter::value() const
+{
+	return total.load(std::memory_order_relaxed);
+}
+
+MetricHistogram::MetricHistogram(const std::vector<double>& bounds) :
+	upper_bounds(bounds),
+	buckets(new std::atomic<uint64_t>[bounds.size() + 1]),
+	observations(0),
+	total(0.0)
+{
+	for (size_t bucket = 0; bucket <= bounds.size(); ++bucket) {
+		buckets[bucket].store(0, std::memory_order_relaxed);
+	}
+}
+
+void MetricHistogram::observe(double value)
+{
+	size_t bucket = 0;
+	while (bucket < upper_bounds.size() && value > upper_bounds[bucket]) {
+		++bucket;
+	}
+	buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	observations.fetch_add(1, std::memory_order_relaxed);
+
+	// No fetch_add for floating point atomics before C++20
+	double previous = total.load(std::memory_order_relaxed);
+	while (!total.compare_exchange_weak(previous, previous + value, std::memory_order_relaxed)) {
+	}
+}
+
+const std::vector<double>& MetricHistogram::bounds() const
+{
+	return upper_bounds;
+}
+
+uint64_t MetricHistogram::bucket_count(size_t bucket) const
+{
+	return buckets[bucket].load(std::memory_order_relaxed);
+}
+
+uint64_t MetricHistogram::count() const
+{
+	return observations.load(std::memory_order_relaxed);
+}
+
+double MetricHistogram::sum() const
+{
+	return total.load(std::memory_order_relaxed);
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help)
+{
+	metrics.push_back({ name, help, std::make_unique<MetricCounter>(), nullptr });
+	return *metrics.back().counter;
+}
+
+MetricHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds)
+{
+	metrics.push_back({ name, help, nullptr, std::make_unique<MetricHistogram>(bounds) });
+	return *metrics.back().histogram;
+}
+
+void MetricsRegistry::write_prometheus(std::ostream& out) const
+{
+	for (const Metric& metric : metrics) {
+		out << "# HELP " << metric.name << " " << metric.help << "\n";
+
+		if (metric.counter) {
+			out << "# TYPE " << metric.name << " counter\n";
+			out << metric.name << " " << metric.counter->value() << "\n";
+			continue;
+		}
+
+		// Buckets are read one by one while the hot loop keeps observing, so they are only approximately consistent
+		const MetricHistogram& histogram = *metric.histogram;
+		out << "# TYPE " << metric.name << " histogram\n";
+		uint64_t cumulative = 0;
+		for (size_t bucket = 0; bucket < histogram.bounds().size(); ++bucket) {
+			cumulative += histogram.bucket_count(bucket);
+			out << metric.name << "_bucket{le=\"" << histogram.bounds()[bucket] << "\"} " << cumulative << "\n";
+		}
+		cumulative += histogram.bucket_count(histogram.bounds().size());
+		out << metric.name << "_bucket{le=\"+Inf\"} " << cumulative << "\n";
+		out << metric.name << "_sum " << histogram.sum() << "\n";
+		out << metric.name << "_count " << cumulative << "\n";
+	}
+}
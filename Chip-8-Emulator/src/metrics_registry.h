@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Monotonic count, updated with relaxed atomics so the hot loop never waits for a reader
+class MetricCounter
+{
+public:
+	MetricCounter();
+
+	void add(uint64_t amount = 1);
+	uint64_t value() const;
+
+private:
+	std::atomic<uint64_t> total;
+};
+
+// Cumulative buckets as in Prometheus, each observation lands in the first bucket whose bound it does not exceed
+class MetricHistogram
+{
+public:
+	explicit MetricHistogram(const std::vector<double>& bounds);
+
+	void observe(double value);
+
+	const std::vector<double>& bounds() const;
+	uint64_t bucket_count(size_t bucket) const;	// the last bucket is +Inf
+	uint64_t count() const;
+	double sum() const;
+
+private:
+	std::vector<double> upper_bounds;
+	std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+	std::atomic<uint64_t> observations;
+	std::atomic<double> total;
+};
+
+// Metrics of one emulator instance. Registration is not thread safe and happens before the exporter starts, updates
+// and reads can then happen from any thread.
+class MetricsRegistry
+{
+public:
+	MetricCounter& counter(const std::string& name, const std::string& help);
+	MetricHistogram& histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds);
+
+	// Prometheus text exposition format 0.0.4
+	void write_prometheus(std::ostream& out) const;
+
+private:
+	struct Metric
+	{
+		std::string name;
+		std::string help;
+		std::unique_ptr<MetricCounter> counter;
+		std::unique_ptr<MetricHistogram> histogram;
+	};
+
+	std::vector<Metric> metrics;
+};
@@ -0,0 +1,104 @@
+#include "phase_trace.h"
+
+#if CHIP8_TRACING
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct PhaseEvent
+	{
+		const char* name;
+		int64_t start;		// ns since trace_epoch
+		int64_t duration;	// ns
+	};
+
+	// Ring of the last events of one thread, the lock is only contended while the trace is written
+	struct ThreadBuffer
+	{
+		std::mutex mutex;
+		int thread_id;
+		std::vector<PhaseEvent> events;
+		size_t next;		// total events recorded, the next one goes at next % PHASE_TRACE_CAPACITY
+	};
+
+	const std::chrono::steady_clock::time_point trace_epoch = std::chrono::steady_clock::now();
+
+	std::mutex registry_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> registry; // buffers outlive their thread so that they can still be written
+
+	ThreadBuffer& thread_buffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (!buffer) {
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			registry.push_back(std::make_unique<ThreadBuffer>());
+			buffer = registry.back().get();
+			buffer->thread_id = static_cast<int>(registry.size());
+			buffer->events.resize(PHASE_TRACE_CAPACITY);
+			buffer->next = 0;
+		}
+		return *buffer;
+	}
+
+	int64_t since_epoch(std::chrono::steady_clock::time_point time)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time - trace_epoch).count();
+	}
+}
+
+PhaseTraceScope::PhaseTraceScope(const char* name) :
+	name(name),
+	start_time(std::chrono::steady_clock::now())
+{
+}
+
+PhaseTraceScope::~PhaseTraceScope()
+{
+	auto end_time = std::chrono::steady_clock::now();
+
+	ThreadBuffer& buffer = thread_buffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.events[buffer.next % PHASE_TRACE_CAPACITY] = { name, since_epoch(start_time), since_epoch(end_time) - since_epoch(start_time) };
+	++buffer.next;
+}
+
+int write_phase_trace(const std::string& path)
+{
+	std::ofstream output_file(path);
+	if (output_file.fail()) {
+		std::cerr << "Error opening trace file: " << path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// Complete events ("ph":"X"), timestamps and durations in microseconds
+	output_file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+	bool first = true;
+
+	std::lock_guard<std::mutex> registry_lock(registry_mutex);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : registry) {
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+		size_t begin = buffer->next > static_cast<size_t>(PHASE_TRACE_CAPACITY) ? buffer->next - PHASE_TRACE_CAPACITY : 0;
+		for (size_t idx = begin; idx < buffer->next; ++idx) {
+			const PhaseEvent& event = buffer->events[idx % PHASE_TRACE_CAPACITY];
+			output_file << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id
+				<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0 << "}";
+			first = false;
+		}
+	}
+	output_file << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+	if (output_file.fail()) {
+		std::cerr << "Error writing trace file: " << path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Phase trace written to " << path << std::endl;
+	return EXIT_SUCCESS;
+}
+#endif
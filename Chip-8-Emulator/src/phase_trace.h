@@ -0,0 +1,34 @@
+#pragma once
+
+// Scoped trace points of the host loop, written as Chrome trace event JSON (chrome://tracing, Perfetto). Compiled in
+// only when CHIP8_TRACING is defined to 1, otherwise PHASE_TRACE_SCOPE expands to nothing.
+#if CHIP8_TRACING
+#include <chrono>
+#include <string>
+
+class PhaseTraceScope
+{
+public:
+	explicit PhaseTraceScope(const char* name);
+	~PhaseTraceScope();
+
+	PhaseTraceScope(const PhaseTraceScope&) = delete;
+	PhaseTraceScope& operator=(const PhaseTraceScope&) = delete;
+
+private:
+	const char* name; // string literal, only the pointer is recorded
+	std::chrono::steady_clock::time_point start_time;
+};
+
+// Each thread records its last PHASE_TRACE_CAPACITY scopes, older ones are overwritten
+const int PHASE_TRACE_CAPACITY = 1 << 16;
+
+// Every thread's recorded scopes, can be called while the other threads keep recording
+int write_phase_trace(const std::string& path);
+
+#define PHASE_TRACE_CONCAT_(a, b) a##b
+#define PHASE_TRACE_CONCAT(a, b) PHASE_TRACE_CONCAT_(a, b)
+#define PHASE_TRACE_SCOPE(name) PhaseTraceScope PHASE_TRACE_CONCAT(phase_trace_scope_, __LINE__)(name)
+#else
+#define PHASE_TRACE_SCOPE(name)
+#endif
@@ -0,0 +1,56 @@
+#include "realtime.h"
+#include <iostream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <timeapi.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+#endif
+
+bool enable_low_jitter(int core)
+{
+	bool granted = true;
+
+#if defined(_WIN32)
+	if (!SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << core)) {
+		std::cerr << "Could not pin the emulation thread to core " << core << std::endl;
+		granted = false;
+	}
+
+	if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+		std::cerr << "Could not raise the emulation thread priority" << std::endl;
+		granted = false;
+	}
+
+	// Default timer resolution is 15.6ms, which makes every sleep overshoot
+	if (timeBeginPeriod(1) != TIMERR_NOERROR) {
+		std::cerr << "Could not raise the system timer resolution" << std::endl;
+		granted = false;
+	}
+#elif defined(__linux__)
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(core, &cpu_set);
+	int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+	if (error) {
+		std::cerr << "Could not pin the emulation thread to core " << core << ": " << std::strerror(error) << std::endl;
+		granted = false;
+	}
+
+	sched_param param{};
+	param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+	error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (error) {
+		std::cerr << "Could not switch the emulation thread to SCHED_FIFO: " << std::strerror(error) << std::endl;
+		granted = false;
+	}
+#else
+	std::cerr << "Low jitter mode is not supported on this platform" << std::endl;
+	granted = false;
+#endif
+
+	return granted;
+}
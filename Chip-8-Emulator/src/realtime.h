@@ -0,0 +1,5 @@
+#pragma once
+
+// Reduce scheduling jitter of the calling thread: pin it to a core and raise it to real-time priority where permitted.
+// Returns false if any of the requests was refused, the thread keeps running with whatever was granted.
+bool enable_low_jitter(int core);
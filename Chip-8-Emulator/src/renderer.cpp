@@ -1,9 +1,9 @@
 #include "renderer.h"
+#include "phase_trace.h"
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <GL/freeglut_std.h>
-#include <sstream>
-#include <filesystem>
 
 Renderer::Renderer(const std::string& title, int display_width, int display_height, int display_scale, int debug_width) :
 	title(title),
@@ -11,18 +11,50 @@ Renderer::Renderer(const std::string& title, int display_width, int display_heig
 	display_height(display_height),
 	display_scale(display_scale),
 	debug_width(debug_width),
-	window(nullptr)
+	window(nullptr),
+	font(display_scale >= 8 ? display_scale / 8 : 1),
+	debug_pixels(debug_width * display_scale * display_height * display_scale, 0),
+	debug_texture(0),
+	debug_fields{},
+	dirty_top(display_height * display_scale),
+	dirty_bottom(-1),
+	debug_refresh_interval(1.0 / DEBUG_REFRESH_RATE),
+	last_debug_refresh(0.0),
+	pacing_lateness(nullptr),
+	heatmap(nullptr),
+	heatmap_texture(0),
+	heatmap_x(static_cast<int>(8.0f * display_scale)),
+	heatmap_y(debug_line_y(14)),
+	heatmap_side(std::min((debug_width - 8) * display_scale, display_height * display_scale - debug_line_y(14)))
 {
+	const float column_1 = 1.0f;
+	const float column_2 = 8.0f;
+
+	char label[] = "V0 = #";
+	for (int i = 0; i < 16; ++i) {
+		label[1] = "0123456789ABCDEF"[i];
+		init_debug_field(debug_fields[i], label, 16, 2, column_1, i);
+	}
+
+	init_debug_field(debug_fields[16], "DT = #", 16, 2, column_2, 0);
+	init_debug_field(debug_fields[17], "ST = #", 16, 2, column_2, 1);
+	init_debug_field(debug_fields[18], " I = #", 16, 4, column_2, 4);
+	init_debug_field(debug_fields[19], "PC = #", 16, 4, column_2, 6);
+	init_debug_field(debug_fields[20], "SP = #", 16, 2, column_2, 7);
+
+	// Frame lateness in microseconds, the header never changes and is rasterised once
+	draw_debug_text("LATE US", static_cast<int>(column_2 * display_scale), debug_line_y(9));
+	init_debug_field(debug_fields[21], "P50 ", 10, 5, column_2, 10);
+	init_debug_field(debug_fields[22], "P99 ", 10, 5, column_2, 11);
+	init_debug_field(debug_fields[23], "MAX ", 10, 5, column_2, 12);
 }
 
-int Renderer::init(int argc, char* argv[])
+int Renderer::init()
 {
 	if (!glfwInit()) {
 		return EXIT_FAILURE;
 	}
 
-	glutInit(&argc, argv);
-
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 	return EXIT_SUCCESS;
 }
@@ -36,6 +68,21 @@ int Renderer::create_window()
 	}
 
 	glfwMakeContextCurrent(window);
+
+	glGenTextures(1, &debug_texture);
+	glBindTexture(GL_TEXTURE_2D, debug_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, debug_width * display_scale, display_height * display_scale, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, debug_pixels.data());
+
+	glGenTextures(1, &heatmap_texture);
+	glBindTexture(GL_TEXTURE_2D, heatmap_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, MemoryHeatmap::SIZE, MemoryHeatmap::SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
 	return EXIT_SUCCESS;
 }
 
@@ -43,13 +90,68 @@ void Renderer::set_key_callback(GLFWkeyfun callback) {
 	glfwSetKeyCallback(window, callback);
 }
 
-void Renderer::draw(const Emulator& emulator) const
+void Renderer::set_debug_refresh_rate(int refresh_rate)
+{
+	debug_refresh_interval = 1.0 / refresh_rate;
+}
+
+void Renderer::set_pacing_stats(const LatencyHistogram* lateness)
 {
+	pacing_lateness = lateness;
+}
+
+void Renderer::set_heatmap(const MemoryHeatmap* memory_heatmap)
+{
+	heatmap = memory_heatmap;
+	draw_debug_text(heatmap ? "MEM RWX" : "       ", heatmap_x, debug_line_y(13));
+}
+
+bool Renderer::debug_refresh_due() const
+{
+	return glfwGetTime() - last_debug_refresh >= debug_refresh_interval;
+}
+
+int Renderer::refresh_rate() const
+{
+	GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+	const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+	return mode && mode->refreshRate > 0 ? mode->refreshRate : 60;
+}
+
+void Renderer::set_vsync(bool enabled)
+{
+	glfwSwapInterval(enabled ? 1 : 0);
+}
+
+void Renderer::draw(const Emulator& emulator)
+{
+	PHASE_TRACE_SCOPE("renderer.draw");
+
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	draw_display(emulator);
-	draw_debug(emulator);
+	{
+		PHASE_TRACE_SCOPE("draw_display");
+		draw_display(emulator);
+	}
 
+	{
+		PHASE_TRACE_SCOPE("draw_debug");
+		if (debug_refresh_due()) {
+			update_debug(emulator);
+		}
+		draw_debug();
+
+		// The whole heatmap changes every frame, 12 KB uploaded at once
+		if (heatmap) {
+			glBindTexture(GL_TEXTURE_2D, heatmap_texture);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, MemoryHeatmap::SIZE, MemoryHeatmap::SIZE, GL_RGB, GL_UNSIGNED_BYTE, heatmap->pixels());
+			glBindTexture(GL_TEXTURE_2D, 0);
+			draw_heatmap();
+		}
+	}
+
+	PHASE_TRACE_SCOPE("glfwSwapBuffers");
 	glfwSwapBuffers(window);
 }
 
@@ -64,55 +166,129 @@ void Renderer::draw_display(const Emulator& emulator) const
 	}
 }
 
-void Renderer::draw_debug(const Emulator& emulator) const
+void Renderer::update_debug(const Emulator& emulator)
 {
-	const float scale = 0.125f;
-	const float line_height = 1.5f;
-	const float column_1_x = 1.0f;
-	const float column_2_x = 8.0f;
+	last_debug_refresh = glfwGetTime();
 
-	for (uint16_t i = 0; i < 16; ++i) {
-		std::ostringstream str_stream;
-		str_stream << std::uppercase << std::hex << "V" << i << " = #" << std::setw(2) << std::setfill('0') << static_cast<int>(emulator.v[i]);
-		draw_debug_text(str_stream.str(), column_1_x, (i + 1) * line_height, scale);
+	int values[DEBUG_FIELD_COUNT];
+	for (int i = 0; i < 16; ++i) {
+		values[i] = emulator.v[i];
 	}
+	values[16] = emulator.dt;
+	values[17] = emulator.st;
+	values[18] = emulator.i;
+	values[19] = emulator.pc;
+	values[20] = emulator.sp;
 
-	{
-		std::ostringstream str_stream;
-		str_stream << std::uppercase << std::hex << "DT = #" << std::setw(2) << std::setfill('0') << static_cast<int>(emulator.dt);
-		draw_debug_text(str_stream.str(), column_2_x, 1.0f * line_height, scale);
+	values[21] = values[22] = values[23] = 0;
+	if (pacing_lateness) {
+		const long long max_lateness_us = 99999;
+		values[21] = static_cast<int>(std::min<long long>(pacing_lateness->percentile(50.0).count() / 1000, max_lateness_us));
+		values[22] = static_cast<int>(std::min<long long>(pacing_lateness->percentile(99.0).count() / 1000, max_lateness_us));
+		values[23] = static_cast<int>(std::min<long long>(pacing_lateness->max().count() / 1000, max_lateness_us));
 	}
 
-	{
-		std::ostringstream str_stream;
-		str_stream << std::uppercase << std::hex << "ST = #" << std::setw(2) << std::setfill('0') << static_cast<int>(emulator.st);
-		draw_debug_text(str_stream.str(), column_2_x, 2.0f * line_height, scale);
-	}
+	// Only the fields whose value changed since the last refresh are rasterised again
+	for (int idx = 0; idx < DEBUG_FIELD_COUNT; ++idx) {
+		DebugField& field = debug_fields[idx];
+		if (field.value == values[idx]) {
+			continue;
+		}
+		field.value = values[idx];
 
-	{
-		std::ostringstream str_stream;
-		str_stream << std::uppercase << std::hex << " I = #" << std::setw(4) << std::setfill('0') << static_cast<int>(emulator.i);
-		draw_debug_text(str_stream.str(), column_2_x, 5.0f * line_height, scale);
-	}
+		char text[16];
+		size_t length = std::strlen(field.label);
+		std::memcpy(text, field.label, length);
+		int value = field.value;
+		for (int digit = field.digits - 1; digit >= 0; --digit) {
+			bool padding = field.base == 10 && value == 0 && digit != field.digits - 1;
+			text[length + digit] = padding ? ' ' : "0123456789ABCDEF"[value % field.base];
+			value /= field.base;
+		}
+		text[length + field.digits] = '\0';
 
-	{
-		std::ostringstream str_stream;
-		str_stream << std::uppercase << std::hex << "PC = #" << std::setw(4) << std::setfill('0') << static_cast<int>(emulator.pc);
-		draw_debug_text(str_stream.str(), column_2_x, 7.0f * line_height, scale);
+		draw_debug_text(text, field.x, field.y);
 	}
 
-	{
-		std::ostringstream str_stream;
-		str_stream << std::uppercase << std::hex << "SP = #" << std::setw(2) << std::setfill('0') << static_cast<int>(emulator.sp);
-		draw_debug_text(str_stream.str(), column_2_x, 8.0f * line_height, scale);
+	if (dirty_bottom < dirty_top) {
+		return;
 	}
+
+	// Rows are contiguous in the panel bitmap, upload the modified band only
+	const int panel_width = debug_width * display_scale;
+	glBindTexture(GL_TEXTURE_2D, debug_texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, dirty_top, panel_width, dirty_bottom - dirty_top + 1, GL_LUMINANCE, GL_UNSIGNED_BYTE, debug_pixels.data() + dirty_top * panel_width);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	dirty_top = display_height * display_scale;
+	dirty_bottom = -1;
+}
+
+void Renderer::draw_debug() const
+{
+	float ndc_x = 2.0f * (static_cast<float>(display_width) / (display_width + debug_width)) - 1.0f;
+
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, debug_texture);
+
+	// The first row of the panel bitmap is the top of the window
+	glBegin(GL_QUADS);
+	glTexCoord2f(0.0f, 0.0f);
+	glVertex2f(ndc_x, 1.0f);	// Top-left corner
+	glTexCoord2f(1.0f, 0.0f);
+	glVertex2f(1.0f, 1.0f);		// Top-right corner
+	glTexCoord2f(1.0f, 1.0f);
+	glVertex2f(1.0f, -1.0f);	// Bottom-right corner
+	glTexCoord2f(0.0f, 1.0f);
+	glVertex2f(ndc_x, -1.0f);	// Bottom-left corner
+	glEnd();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+}
+
+// Over the debug panel, below the lateness fields
+void Renderer::draw_heatmap() const
+{
+	const float window_width = static_cast<float>((display_width + debug_width) * display_scale);
+	const float window_height = static_cast<float>(display_height * display_scale);
+
+	float left = 2.0f * (display_width * display_scale + heatmap_x) / window_width - 1.0f;
+	float right = 2.0f * (display_width * display_scale + heatmap_x + heatmap_side) / window_width - 1.0f;
+	float top = 1.0f - 2.0f * heatmap_y / window_height;
+	float bottom = 1.0f - 2.0f * (heatmap_y + heatmap_side) / window_height;
+
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, heatmap_texture);
+
+	glBegin(GL_QUADS);
+	glTexCoord2f(0.0f, 0.0f);
+	glVertex2f(left, top);
+	glTexCoord2f(1.0f, 0.0f);
+	glVertex2f(right, top);
+	glTexCoord2f(1.0f, 1.0f);
+	glVertex2f(right, bottom);
+	glTexCoord2f(0.0f, 1.0f);
+	glVertex2f(left, bottom);
+	glEnd();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
 }
 
 void Renderer::poll_events()
 {
+	PHASE_TRACE_SCOPE("poll_events");
 	glfwPollEvents();
 }
 
+// Block until a window or input event arrives
+void Renderer::wait_events()
+{
+	glfwWaitEvents();
+}
+
 bool Renderer::should_close() const
 {
 	return glfwWindowShouldClose(window);
@@ -120,6 +296,15 @@ bool Renderer::should_close() const
 
 void Renderer::close()
 {
+	if (debug_texture) {
+		glDeleteTextures(1, &debug_texture);
+		debug_texture = 0;
+	}
+	if (heatmap_texture) {
+		glDeleteTextures(1, &heatmap_texture);
+		heatmap_texture = 0;
+	}
+
 	glfwTerminate();
 }
 
@@ -141,27 +326,42 @@ void Renderer::draw_display_square(int x, int y) const
 	glEnd();
 }
 
-void Renderer::draw_debug_text(const std::string& text, float x, float y, float scale) const
+void Renderer::init_debug_field(DebugField& field, const char* label, int base, int digits, float column, int line)
 {
-	glMatrixMode(GL_PROJECTION);
-	glPushMatrix();
-	{
-		glLoadIdentity();
-		glOrtho(0, (display_width + debug_width) * display_scale, 0, display_height * display_scale, 0, 1);
-		glMatrixMode(GL_MODELVIEW);
-		glPushMatrix();
-		{
-			glLoadIdentity();
-			glTranslatef((x + display_width) * display_scale, (display_height - y) * display_scale, 0.0f);
-			glScalef(scale, scale, 1.0f);
-			for (const char c : text) {
-				glutStrokeCharacter(GLUT_STROKE_ROMAN, (int)c);
-			}
-			glScalef(1.0f, 1.0f, 1.0f);
-		}
-		glPopMatrix();
-		glMatrixMode(GL_PROJECTION);
+	std::strncpy(field.label, label, sizeof(field.label) - 1);
+	field.base = base;
+	field.digits = digits;
+	field.x = static_cast<int>(column * display_scale);
+	field.y = debug_line_y(line);
+	field.value = -1;
+}
+
+int Renderer::debug_line_y(int line) const
+{
+	const float line_height = 1.5f;
+	return static_cast<int>((line * line_height + 0.5f) * display_scale);
+}
+
+// Rasterise text in the panel bitmap from the font atlas, x and y are the top-left corner in panel pixels
+void Renderer::draw_debug_text(const char* text, int x, int y)
+{
+	const int panel_width = debug_width * display_scale;
+	const int panel_height = display_height * display_scale;
+	const int cell_width = font.cell_width();
+	const int cell_height = font.cell_height();
+
+	if (y < 0 || y + cell_height > panel_height) {
+		return;
+	}
+
+	for (; *text && x + cell_width <= panel_width; ++text, x += cell_width) {
+		font.blit(*text, debug_pixels.data() + x + y * panel_width, panel_width);
+	}
+
+	if (y < dirty_top) {
+		dirty_top = y;
+	}
+	if (y + cell_height - 1 > dirty_bottom) {
+		dirty_bottom = y + cell_height - 1;
 	}
-	glPopMatrix();
-	glMatrixMode(GL_MODELVIEW);
 }
@@ -1,24 +1,47 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <GLFW/glfw3.h>
-#include <iostream>
 #include "emulator.h"
-#include <ostream>
+#include "font_atlas.h"
+#include "latency_histogram.h"
+#include "memory_heatmap.h"
 
 class Renderer
 {
 public:
+	static const int DEBUG_REFRESH_RATE = 30; // the debug panel is refreshed independently of the emulated display
+
 	Renderer(const std::string& title, int display_width, int display_height, int display_scale, int debug_width);
 
-	int init(int argc, char* argv[]);
+	int init();
 	int create_window();
 	void set_key_callback(GLFWkeyfun callback);
-	void draw(const Emulator& emulator) const;
+	void set_debug_refresh_rate(int refresh_rate);
+	void set_pacing_stats(const LatencyHistogram* lateness);
+	void set_heatmap(const MemoryHeatmap* memory_heatmap); // nullptr hides the heatmap
+	bool debug_refresh_due() const;
+	int refresh_rate() const; // of the monitor showing the window, 60 when unknown
+	void set_vsync(bool enabled); // on by default, presenting then waits for the next refresh
+	void draw(const Emulator& emulator);
 	void poll_events();
+	void wait_events();
 	bool should_close() const;
 	void close();
 
 private:
+	static const int DEBUG_FIELD_COUNT = 24; // V0 to VF, DT, ST, I, PC, SP and the p50, p99 and max frame lateness
+
+	struct DebugField
+	{
+		char label[8];
+		int base;	// hexadecimal fields are zero padded, decimal fields space padded
+		int digits;
+		int x;
+		int y;
+		int value; // last value written in the panel, -1 if never drawn
+	};
+
 	std::string title;
 	int display_width;
 	int display_height;
@@ -26,9 +49,28 @@ private:
 	int debug_width;
 	GLFWwindow* window;
 
+	FontAtlas font;
+	std::vector<uint8_t> debug_pixels; // luminance bitmap of the whole debug panel, uploaded as a texture
+	GLuint debug_texture;
+	DebugField debug_fields[DEBUG_FIELD_COUNT];
+	int dirty_top;						// first panel row modified since the last upload
+	int dirty_bottom;					// last panel row modified since the last upload, -1 if clean
+	double debug_refresh_interval;
+	double last_debug_refresh;
+	const LatencyHistogram* pacing_lateness;
+	const MemoryHeatmap* heatmap;
+	GLuint heatmap_texture;
+	int heatmap_x;						// top-left corner and side in panel pixels
+	int heatmap_y;
+	int heatmap_side;
+
 	void draw_display(const Emulator& emulator) const;
-	void draw_debug(const Emulator& emulator) const;
+	void update_debug(const Emulator& emulator);
+	void draw_debug() const;
+	void draw_heatmap() const;
 
 	void draw_display_square(int x, int y) const;
-	void draw_debug_text(const std::string& text, float x, float y, float scale) const;
-};
\ No newline at end of file
+	void init_debug_field(DebugField& field, const char* label, int base, int digits, float column, int line);
+	int debug_line_y(int line) const;
+	void draw_debug_text(const char* text, int x, int y);
+};
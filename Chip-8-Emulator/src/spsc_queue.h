@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Lock-free ring buffer for exactly one producer thread and one consumer thread
+template <typename T, size_t CAPACITY>
+class SpscQueue
+{
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+	SpscQueue() :
+		head(0),
+		tail(0)
+	{
+	}
+
+	// Called by the producer, false if the queue is full
+	bool push(const T& item)
+	{
+		size_t write = tail.load(std::memory_order_relaxed);
+		if (write - head.load(std::memory_order_acquire) == CAPACITY) {
+			return false;
+		}
+
+		items[write & (CAPACITY - 1)] = item;
+		tail.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Called by the consumer, the next item without removing it, false if the queue is empty
+	bool peek(T& item) const
+	{
+		size_t read = head.load(std::memory_order_relaxed);
+		if (read == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		item = items[read & (CAPACITY - 1)];
+		return true;
+	}
+
+	// Called by the consumer, false if the queue is empty
+	bool pop(T& item)
+	{
+		size_t read = head.load(std::memory_order_relaxed);
+		if (read == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		item = items[read & (CAPACITY - 1)];
+		head.store(read + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T items[CAPACITY];
+	alignas(64) std::atomic<size_t> head;	// next item to read, owned by the consumer
+	alignas(64) std::atomic<size_t> tail;	// next slot to write, owned by the producer
+};
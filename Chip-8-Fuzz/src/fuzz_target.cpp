@@ -0,0 +1,85 @@
+#include "emulator.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+
+// The core prints every instruction executed in _DEBUG builds. The Debug configurations of this project leave it out
+// and do not use the debug libraries, whose runtime would define it
+#if _DEBUG
+#error Chip-8-Fuzz must be built without _DEBUG
+#endif
+
+// libFuzzer entry point, AFL++ runs it in persistent mode through its libFuzzer driver. Fuzz input layout:
+//   byte 0: number N of key events, at most MAX_EVENTS
+//   N x 2 bytes: frame of the event, then the key in the low nibble and bit 4 set when pressed
+//   remaining bytes: the program, loaded at 0x200
+namespace
+{
+	const int MAX_EVENTS = 16;
+	const uint64_t MAX_FRAMES = 32; // short runs keep the execution rate high, coverage comes from the corpus
+
+	struct KeyEvent
+	{
+		uint8_t frame;
+		uint8_t key;
+		bool pressed;
+	};
+
+	// Fonts loaded and seeded once, each input starts from this state instead of init and its file access
+	MachineState make_pristine()
+	{
+		const uint8_t no_program = 0;
+
+		Emulator emulator;
+		emulator.init(&no_program, 0);
+		emulator.seed(1);
+		return emulator.save_state();
+	}
+
+	const MachineState pristine = make_pristine();
+	Emulator emulator;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	if (size == 0) {
+		return 0;
+	}
+
+	size_t event_count = data[0] < MAX_EVENTS ? data[0] : MAX_EVENTS;
+	if (size < 1 + event_count * 2) {
+		return 0;
+	}
+
+	KeyEvent events[MAX_EVENTS];
+	for (size_t idx = 0; idx < event_count; ++idx) {
+		events[idx] = { data[1 + idx * 2], static_cast<uint8_t>(data[2 + idx * 2] & 0xF), (data[2 + idx * 2] & 0x10) != 0 };
+	}
+
+	const uint8_t* program = data + 1 + event_count * 2;
+	size_t program_size = size - 1 - event_count * 2;
+
+	emulator.load_state(pristine);
+	if (emulator.load_program(program, program_size) == EXIT_FAILURE) {
+		return 0;
+	}
+
+	// Invalid opcodes and stack misuse are program errors reported as exceptions, anything else is a bug
+	try {
+		bool running = true;
+		for (uint64_t frame = 0; running && frame < MAX_FRAMES; ++frame) {
+			for (size_t idx = 0; idx < event_count; ++idx) {
+				if (events[idx].frame == frame) {
+					emulator.queue_input(emulator.cycle_count, events[idx].key, events[idx].pressed);
+				}
+			}
+
+			running = emulator.run_frame();
+		}
+	}
+	catch (const std::exception&) {
+	}
+
+	return 0;
+}
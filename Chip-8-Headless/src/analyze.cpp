@@ -0,0 +1,129 @@
+#include "commands.h"
+#include "disassembler.h"
+#include "emulator.h"
+#include "file_utils.h"
+#include "program_analysis.h"
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const uint16_t PROGRAM_START = 0x200;
+
+	std::ostream& address(std::ostream& out, int value)
+	{
+		return out << "#" << std::uppercase << std::hex << std::setw(3) << std::setfill('0') << value << std::dec << std::setfill(' ');
+	}
+
+	void print_issues(const ProgramAnalysis& analysis)
+	{
+		for (const AnalysisIssue& issue : analysis.issues) {
+			std::cout << (issue.severity == AnalysisIssue::ERROR ? "ERROR   " : "WARNING ");
+			address(std::cout, issue.address) << ": " << issue.message << std::endl;
+		}
+	}
+
+	// Program bytes never reached as an instruction, sprites and tables most of the time
+	void print_data_ranges(const ProgramAnalysis& analysis, size_t program_size)
+	{
+		size_t end = PROGRAM_START + program_size;
+		for (size_t start = PROGRAM_START; start < end;) {
+			if (analysis.flags[start] & ProgramAnalysis::CODE) {
+				++start;
+				continue;
+			}
+
+			size_t stop = start;
+			while (stop < end && !(analysis.flags[stop] & ProgramAnalysis::CODE)) {
+				++stop;
+			}
+			std::cout << "data    ";
+			address(std::cout, static_cast<int>(start)) << "-";
+			address(std::cout, static_cast<int>(stop - 1)) << " (" << stop - start << " bytes)" << std::endl;
+			start = stop;
+		}
+	}
+
+	void print_blocks(const ProgramAnalysis& analysis, const uint8_t* memory)
+	{
+		for (const BasicBlock& block : analysis.blocks) {
+			std::cout << std::endl;
+			address(std::cout, block.start);
+			if (analysis.flags[block.start] & ProgramAnalysis::SUBROUTINE) {
+				std::cout << " (subroutine)";
+			}
+			std::cout << " ->";
+			for (uint16_t successor : block.successors) {
+				address(std::cout << " ", successor);
+			}
+			std::cout << std::endl;
+
+			for (uint16_t pc = block.start; pc != block.end; pc = (pc + 2) & MachineState::ADDRESS_MASK) {
+				uint16_t opcode = memory[pc] << 8 | memory[(pc + 1) & MachineState::ADDRESS_MASK];
+				address(std::cout << "  ", pc) << "  " << std::uppercase << std::hex << std::setw(4) << std::setfill('0') << opcode
+					<< std::dec << std::setfill(' ') << "  " << disassemble(opcode) << std::endl;
+			}
+		}
+	}
+}
+
+int analyze(int argc, char* argv[])
+{
+	std::string program_path;
+	bool show_blocks = false;
+
+	for (int arg_idx = 0; arg_idx < argc; ++arg_idx) {
+		std::string arg = argv[arg_idx];
+
+		if (arg == "--blocks") {
+			show_blocks = true;
+		}
+		else if (program_path.empty() && arg.rfind("--", 0) != 0) {
+			program_path = arg;
+		}
+		else {
+			program_path.clear();
+			break;
+		}
+	}
+
+	if (program_path.empty()) {
+		std::cerr << "Usage: Chip-8-Headless analyze <program> [--blocks]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<uint8_t> program;
+	if (read_binary_file(program_path, program) == EXIT_FAILURE) {
+		std::cerr << "Error reading program: " << program_path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Emulator emulator;
+	if (emulator.init(program.data(), program.size()) == EXIT_FAILURE) {
+		std::cerr << "Failed to initialize emulator with " << program_path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ProgramAnalysis analysis = analyze_program(emulator.memory, PROGRAM_START);
+
+	std::cout << analysis.instruction_count << " instructions in " << analysis.blocks.size() << " blocks, "
+		<< analysis.subroutines.size() << " subroutines, call depth ";
+	if (analysis.max_call_depth < 0) {
+		std::cout << "unbounded";
+	}
+	else {
+		std::cout << analysis.max_call_depth;
+	}
+	std::cout << std::endl;
+
+	print_data_ranges(analysis, program.size());
+	print_issues(analysis);
+	if (show_blocks) {
+		print_blocks(analysis, emulator.memory);
+	}
+
+	return analysis.has_errors() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// Subcommands of Chip-8-Headless, argv starts after the subcommand name
+int regress(int argc, char* argv[]);
+int generate(int argc, char* argv[]);
+int lockstep(int argc, char* argv[]);
+int trace(int argc, char* argv[]);
+int analyze(int argc, char* argv[]);
+int coverage(int argc, char* argv[]);
+int profile(int argc, char* argv[]);
+int netplay(int argc, char* argv[]);
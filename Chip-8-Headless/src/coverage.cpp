@@ -0,0 +1,172 @@
+#include "commands.h"
+#include "coverage_recorder.h"
+#include "disassembler.h"
+#include "emulator.h"
+#include "file_utils.h"
+#include "input_movie.h"
+#include "manifest.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Coverage of every program of a corpus, see manifest.h for the corpus format. The expected hashes are not checked
+namespace
+{
+	struct CoverageResult
+	{
+		CoverageRecorder recorder;
+		size_t program_size;
+		std::string error;
+	};
+
+	void run_case(const ManifestEntry& coverage_case, uint32_t seed, CoverageResult& result)
+	{
+		result.program_size = 0;
+
+		std::vector<uint8_t> program;
+		if (read_binary_file(coverage_case.program_path.string(), program) == EXIT_FAILURE) {
+			result.error = "cannot read program";
+			return;
+		}
+		result.program_size = program.size();
+
+		InputMovie movie;
+		if (!coverage_case.movie_path.empty() && movie.load(coverage_case.movie_path.string()) == EXIT_FAILURE) {
+			result.error = "cannot read input movie";
+			return;
+		}
+
+		Emulator emulator;
+		if (emulator.init(program.data(), program.size()) == EXIT_FAILURE) {
+			result.error = "program too large";
+			return;
+		}
+		emulator.seed(seed);
+		emulator.set_observer(&result.recorder);
+
+		try {
+			bool running = true;
+			for (uint64_t frame = 0; running && frame < coverage_case.frames; ++frame) {
+				movie.apply(emulator, frame);
+				if (emulator.idle() && movie.finished()) {
+					break;
+				}
+				running = emulator.run_frame();
+			}
+		}
+		catch (const std::exception& exception) {
+			result.error = exception.what();
+		}
+	}
+
+	size_t count_in_program(const std::bitset<MachineState::MEMORY_SIZE>& map, size_t program_size)
+	{
+		size_t count = 0;
+		for (size_t address = 0x200; address < 0x200 + program_size; ++address) {
+			count += map[address];
+		}
+		return count;
+	}
+}
+
+int coverage(int argc, char* argv[])
+{
+	std::string manifest_path;
+	unsigned int jobs = 0;
+	uint32_t seed = 0;
+	std::string output_path = "coverage_out";
+
+	for (int arg_idx = 0; arg_idx < argc; ++arg_idx) {
+		std::string arg = argv[arg_idx];
+		bool has_value = arg_idx + 1 < argc;
+
+		if (arg == "--jobs" && has_value) {
+			jobs = static_cast<unsigned int>(std::strtoul(argv[++arg_idx], nullptr, 0));
+		}
+		else if (arg == "--seed" && has_value) {
+			seed = static_cast<uint32_t>(std::strtoul(argv[++arg_idx], nullptr, 0));
+		}
+		else if (arg == "--out" && has_value) {
+			output_path = argv[++arg_idx];
+		}
+		else if (manifest_path.empty() && arg.rfind("--", 0) != 0) {
+			manifest_path = arg;
+		}
+		else {
+			manifest_path.clear();
+			break;
+		}
+	}
+
+	if (manifest_path.empty()) {
+		std::cerr << "Usage: Chip-8-Headless coverage <manifest> [--jobs N] [--seed N] [--out DIR]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<ManifestEntry> cases;
+	if (load_manifest(manifest_path, cases) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+
+	std::vector<CoverageResult> results(cases.size());
+	parallel_for(cases.size(), jobs, [&](size_t index) {
+		run_case(cases[index], seed, results[index]);
+	});
+
+	std::filesystem::create_directories(output_path);
+
+	// Per program share of its bytes executed, read and written
+	CoverageRecorder merged;
+	for (size_t index = 0; index < cases.size(); ++index) {
+		const CoverageResult& result = results[index];
+		merged.merge(result.recorder);
+
+		std::filesystem::path case_path = std::filesystem::path(output_path) / (cases[index].name + ".coverage");
+		if (result.recorder.save(case_path.string()) == EXIT_FAILURE) {
+			std::cerr << "Error writing coverage file: " << case_path.string() << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		std::cout << cases[index].name << ": " << count_in_program(result.recorder.executed, result.program_size) << " of "
+			<< result.program_size << " bytes executed, " << count_in_program(result.recorder.read, result.program_size) << " read, "
+			<< count_in_program(result.recorder.written, result.program_size) << " written";
+		if (!result.error.empty()) {
+			std::cout << " (" << result.error << ")";
+		}
+		std::cout << std::endl;
+	}
+
+	std::filesystem::path merged_path = std::filesystem::path(output_path) / "merged.coverage";
+	if (merged.save(merged_path.string()) == EXIT_FAILURE) {
+		std::cerr << "Error writing coverage file: " << merged_path.string() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// Handlers by executions over the whole corpus, the ones never executed are not exercised by any program
+	std::vector<int> kinds(INSTRUCTION_KIND_COUNT);
+	for (int kind = 0; kind < INSTRUCTION_KIND_COUNT; ++kind) {
+		kinds[kind] = kind;
+	}
+	std::stable_sort(kinds.begin(), kinds.end(), [&](int a, int b) {
+		return merged.instruction_counts[a] > merged.instruction_counts[b];
+	});
+
+	uint64_t total = 0;
+	for (uint64_t count : merged.instruction_counts) {
+		total += count;
+	}
+
+	std::cout << std::endl;
+	for (int kind : kinds) {
+		uint64_t count = merged.instruction_counts[kind];
+		std::cout << std::left << std::setw(18) << INSTRUCTION_NAMES[kind] << std::right << std::setw(14) << count << std::setw(8)
+			<< std::fixed << std::setprecision(2) << (total ? 100.0 * count / total : 0.0) << " %" << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
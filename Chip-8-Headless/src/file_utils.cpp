@@ -0,0 +1,15 @@
+#include "file_utils.h"
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+int read_binary_file(const std::string& path, std::vector<uint8_t>& data)
+{
+	std::ifstream input_file(path, std::ios_base::binary);
+	if (input_file.fail()) {
+		return EXIT_FAILURE;
+	}
+
+	data.assign(std::istreambuf_iterator<char>(input_file), std::istreambuf_iterator<char>());
+	return input_file.bad() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+int read_binary_file(const std::string& path, std::vector<uint8_t>& data);
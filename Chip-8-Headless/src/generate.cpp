@@ -0,0 +1,63 @@
+#include "commands.h"
+#include "workload_generator.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int generate(int argc, char* argv[])
+{
+	std::string output_path;
+	WorkloadOptions options;
+	bool valid = true;
+
+	for (int arg_idx = 0; valid && arg_idx < argc; ++arg_idx) {
+		std::string arg = argv[arg_idx];
+		bool has_value = arg_idx + 1 < argc;
+
+		if (arg == "--mix" && has_value) {
+			valid = parse_workload_mix(argv[++arg_idx], options.mix);
+		}
+		else if (arg == "--size" && has_value) {
+			options.size = std::strtoull(argv[++arg_idx], nullptr, 0);
+		}
+		else if (arg == "--seed" && has_value) {
+			options.seed = static_cast<uint32_t>(std::strtoul(argv[++arg_idx], nullptr, 0));
+		}
+		else if (arg == "--loops" && has_value) {
+			options.loop_count = std::atoi(argv[++arg_idx]);
+		}
+		else if (arg == "--depth" && has_value) {
+			options.call_depth = std::atoi(argv[++arg_idx]);
+		}
+		else if (output_path.empty() && arg.rfind("--", 0) != 0) {
+			output_path = arg;
+		}
+		else {
+			valid = false;
+		}
+	}
+
+	if (!valid || output_path.empty()) {
+		std::cerr << "Usage: Chip-8-Headless gen <output> [--mix KIND=WEIGHT,...] [--size BYTES] [--seed N] [--loops N] [--depth N]" << std::endl;
+		std::cerr << "       KIND is one of";
+		for (int workload = 0; workload < WORKLOAD_COUNT; ++workload) {
+			std::cerr << " " << workload_name(static_cast<Workload>(workload));
+		}
+		std::cerr << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<uint8_t> program = generate_workload(options);
+
+	std::ofstream output_file(output_path, std::ios::binary);
+	output_file.write(reinterpret_cast<const char*>(program.data()), program.size());
+	if (output_file.fail()) {
+		std::cerr << "Error writing program: " << output_path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Generated " << program.size() << " bytes: " << output_path << std::endl;
+	return EXIT_SUCCESS;
+}
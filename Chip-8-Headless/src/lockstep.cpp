@@ -0,0 +1,315 @@
+#include "commands.h"
+#include "emulator.h"
+#include "file_utils.h"
+#include "input_movie.h"
+#include "manifest.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Differential check of two execution backends over a corpus: both run the same program and input movie frame by
+// frame through Emulator::run_frame, as every host does. Their states are compared at the first frame boundary every
+// interval cycles, a mismatch is narrowed down to the first diverging frame, then replayed through run_cycles to find
+// the first diverging instruction of that frame
+namespace
+{
+	// Everything needed to replay a machine from a frame boundary
+	struct Machine
+	{
+		Emulator emulator;
+		InputMovie movie;
+		uint64_t frame;		// next frame to run, its movie events not applied yet
+		bool running;
+		std::string error;
+	};
+
+	struct LockstepResult
+	{
+		bool diverged;
+		std::string report;
+	};
+
+	void run_frame(Machine& machine)
+	{
+		machine.movie.apply(machine.emulator, machine.frame);
+		try {
+			machine.running = machine.emulator.run_frame();
+		}
+		catch (const std::exception& exception) {
+			machine.running = false;
+			machine.error = exception.what();
+		}
+		++machine.frame;
+	}
+
+	// The first cycles of the next frame, without the frame bookkeeping of run_frame
+	void run_partial_frame(Machine& machine, uint64_t cycles)
+	{
+		machine.movie.apply(machine.emulator, machine.frame);
+		try {
+			machine.running = machine.emulator.run_cycles(cycles);
+		}
+		catch (const std::exception& exception) {
+			machine.running = false;
+			machine.error = exception.what();
+		}
+	}
+
+	// cycle_budget is not part of the state hash, a wrong carry only changes the length of the next frames
+	bool same_state(const Machine& first, const Machine& second)
+	{
+		return first.running == second.running && first.error == second.error && first.emulator.cycle_budget == second.emulator.cycle_budget
+			&& first.emulator.state_hash() == second.emulator.state_hash();
+	}
+
+	// Field by field differences, "name = first / second"
+	std::string describe_differences(const Machine& first, const Machine& second)
+	{
+		const Emulator& a = first.emulator;
+		const Emulator& b = second.emulator;
+
+		std::ostringstream out;
+		out << std::hex << std::uppercase;
+		auto field = [&out](const char* name, int value_a, int value_b) {
+			if (value_a != value_b) {
+				out << " " << name << " = #" << value_a << " / #" << value_b << ";";
+			}
+		};
+
+		field("PC", a.pc, b.pc);
+		field("I", a.i, b.i);
+		field("SP", a.sp, b.sp);
+		field("DT", a.dt, b.dt);
+		field("ST", a.st, b.st);
+		field("STATUS", a.status, b.status);
+		field("KEYS", a.inputs_mask, b.inputs_mask);
+		field("BUDGET", a.cycle_budget, b.cycle_budget);
+		for (int idx = 0; idx < 16; ++idx) {
+			std::string name = "V" + std::string(1, "0123456789ABCDEF"[idx]);
+			field(name.c_str(), a.v[idx], b.v[idx]);
+		}
+		for (int idx = 0; idx < Emulator::STACK_SIZE; ++idx) {
+			if (a.stack[idx] != b.stack[idx]) {
+				out << " STACK[" << idx << "] = #" << a.stack[idx] << " / #" << b.stack[idx] << ";";
+			}
+		}
+		for (int address = 0; address < Emulator::MEMORY_SIZE; ++address) {
+			if (a.memory[address] != b.memory[address]) {
+				out << " MEM[#" << address << "] = #" << static_cast<int>(a.memory[address]) << " / #" << static_cast<int>(b.memory[address]) << ";";
+				break;
+			}
+		}
+		if (!std::equal(std::begin(a.display), std::end(a.display), std::begin(b.display))) {
+			out << " display differs;";
+		}
+		if (a.cycle_count != b.cycle_count || first.error != second.error) {
+			out << std::dec << " stopped at cycle " << a.cycle_count << " / " << b.cycle_count;
+			out << " (" << (first.error.empty() ? "-" : first.error) << " / " << (second.error.empty() ? "-" : second.error) << ");";
+		}
+
+		return out.str();
+	}
+
+	// first and second match at the start of their next frame and differ at its end, find the first differing cycle
+	std::string bisect_frame(const Machine& first, const Machine& second)
+	{
+		Machine replay_a;
+		Machine replay_b;
+		auto replay = [&](uint64_t cycles) {
+			replay_a = first;
+			replay_b = second;
+			run_partial_frame(replay_a, cycles);
+			run_partial_frame(replay_b, cycles);
+			return same_state(replay_a, replay_b);
+		};
+
+		std::ostringstream out;
+		out << "frame " << first.frame << ", ";
+
+		// Every instruction of the frame agrees, the difference comes from run_frame itself: the stop when blocked,
+		// the cycle budget carried to the next frame or the timers
+		uint64_t mismatch_cycle = first.emulator.next_frame_cycles();
+		if (replay(mismatch_cycle)) {
+			replay_a = first;
+			replay_b = second;
+			run_frame(replay_a);
+			run_frame(replay_b);
+			out << "end of run_frame at cycle " << replay_a.emulator.cycle_count << ";" << describe_differences(replay_a, replay_b);
+			return out.str();
+		}
+
+		uint64_t matching_cycle = 0;
+		while (mismatch_cycle - matching_cycle > 1) {
+			uint64_t middle = matching_cycle + (mismatch_cycle - matching_cycle) / 2;
+			if (replay(middle)) {
+				matching_cycle = middle;
+			}
+			else {
+				mismatch_cycle = middle;
+			}
+		}
+
+		replay(matching_cycle);
+		const Emulator& emulator = replay_a.emulator;
+		out << "cycle " << emulator.cycle_count << " (PC = #" << std::hex << std::uppercase << emulator.pc << ", opcode = #"
+			<< std::setw(4) << std::setfill('0') << (emulator.memory[emulator.pc & Emulator::ADDRESS_MASK] << 8 | emulator.memory[(emulator.pc + 1) & Emulator::ADDRESS_MASK]) << ");";
+
+		replay(mismatch_cycle);
+		out << describe_differences(replay_a, replay_b);
+		return out.str();
+	}
+
+	// first and second match and differ some frames later, find the first differing frame
+	std::string bisect(Machine first, Machine second)
+	{
+		while (true) {
+			Machine next_a = first;
+			Machine next_b = second;
+			run_frame(next_a);
+			run_frame(next_b);
+			if (!same_state(next_a, next_b)) {
+				return bisect_frame(first, second);
+			}
+
+			first = next_a;
+			second = next_b;
+		}
+	}
+
+	void run_case(const ManifestEntry& entry, const std::string& backend_a, const std::string& backend_b, uint64_t interval, uint32_t seed, LockstepResult& result)
+	{
+		result.diverged = false;
+
+		std::vector<uint8_t> program;
+		if (read_binary_file(entry.program_path.string(), program) == EXIT_FAILURE) {
+			result.report = "cannot read program";
+			return;
+		}
+
+		Machine first;
+		if (!entry.movie_path.empty() && first.movie.load(entry.movie_path.string()) == EXIT_FAILURE) {
+			result.report = "cannot read input movie";
+			return;
+		}
+
+		if (first.emulator.init(program.data(), program.size()) == EXIT_FAILURE) {
+			result.report = "program too large";
+			return;
+		}
+		first.emulator.seed(seed);
+		first.frame = 0;
+		first.running = true;
+
+		Machine second = first;
+		first.emulator.set_backend(make_backend(backend_a));
+		second.emulator.set_backend(make_backend(backend_b));
+
+		Machine checkpoint_a = first;
+		Machine checkpoint_b = second;
+		uint64_t next_check = interval;
+		while (first.running && second.running && first.frame < entry.frames) {
+			run_frame(first);
+			run_frame(second);
+
+			bool last_frame = !first.running || !second.running || first.frame == entry.frames;
+			if (first.emulator.cycle_count < next_check && !last_frame) {
+				continue;
+			}
+			next_check = first.emulator.cycle_count + interval;
+
+			if (!same_state(first, second)) {
+				result.diverged = true;
+				result.report = bisect(checkpoint_a, checkpoint_b);
+				return;
+			}
+
+			checkpoint_a = first;
+			checkpoint_b = second;
+		}
+	}
+}
+
+int lockstep(int argc, char* argv[])
+{
+	std::string manifest_path;
+	std::string backend_a_name = "interpreter";
+	std::string backend_b_name = "cached";
+	uint64_t interval = 4096;
+	unsigned int jobs = 0;
+	uint32_t seed = 0;
+
+	for (int arg_idx = 0; arg_idx < argc; ++arg_idx) {
+		std::string arg = argv[arg_idx];
+		bool has_value = arg_idx + 1 < argc;
+
+		if (arg == "--a" && has_value) {
+			backend_a_name = argv[++arg_idx];
+		}
+		else if (arg == "--b" && has_value) {
+			backend_b_name = argv[++arg_idx];
+		}
+		else if (arg == "--interval" && has_value) {
+			interval = std::strtoull(argv[++arg_idx], nullptr, 0);
+		}
+		else if (arg == "--jobs" && has_value) {
+			jobs = static_cast<unsigned int>(std::strtoul(argv[++arg_idx], nullptr, 0));
+		}
+		else if (arg == "--seed" && has_value) {
+			seed = static_cast<uint32_t>(std::strtoul(argv[++arg_idx], nullptr, 0));
+		}
+		else if (manifest_path.empty() && arg.rfind("--", 0) != 0) {
+			manifest_path = arg;
+		}
+		else {
+			manifest_path.clear();
+			break;
+		}
+	}
+
+	if (manifest_path.empty() || !make_backend(backend_a_name) || !make_backend(backend_b_name) || interval == 0) {
+		std::cerr << "Usage: Chip-8-Headless lockstep <manifest> [--a BACKEND] [--b BACKEND] [--interval N] [--jobs N] [--seed N]" << std::endl;
+		std::cerr << "       BACKEND is one of";
+		for (int backend = 0; backend < BACKEND_COUNT; ++backend) {
+			std::cerr << " " << BACKEND_NAMES[backend];
+		}
+		std::cerr << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<ManifestEntry> entries;
+	if (load_manifest(manifest_path, entries) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+
+	auto start_time = std::chrono::steady_clock::now();
+
+	std::vector<LockstepResult> results(entries.size());
+	parallel_for(entries.size(), jobs, [&](size_t index) {
+		run_case(entries[index], backend_a_name, backend_b_name, interval, seed, results[index]);
+	});
+
+	std::chrono::duration<double, std::milli> elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+	int failed = 0;
+	for (size_t index = 0; index < entries.size(); ++index) {
+		const LockstepResult& result = results[index];
+		if (result.diverged) {
+			++failed;
+			std::cout << "DIVERGED " << entries[index].name << " at " << result.report << std::endl;
+		}
+		else if (!result.report.empty()) {
+			++failed;
+			std::cout << "FAIL " << entries[index].name << ": " << result.report << std::endl;
+		}
+	}
+
+	std::cout << backend_a_name << " / " << backend_b_name << ": " << (entries.size() - failed) << " in lockstep, "
+		<< failed << " failed in " << elapsed_time.count() << " ms" << std::endl;
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+#include "machine_dump.h"
+#include <cstdlib>
+#include <iomanip>
+#include <string>
+
+void write_state(std::ostream& out, const Emulator& emulator)
+{
+	static const char* const status_names[] = { "running", "waiting for input", "halted" };
+
+	auto hex = [&out](int value, int digits) -> std::ostream& {
+		return out << "#" << std::uppercase << std::hex << std::setw(digits) << std::setfill('0') << value << std::dec;
+	};
+
+	out << "PC = "; hex(emulator.pc, 4) << std::endl;
+	out << "I = "; hex(emulator.i, 4) << std::endl;
+	out << "SP = "; hex(emulator.sp, 2) << std::endl;
+	out << "DT = "; hex(emulator.dt, 2) << std::endl;
+	out << "ST = "; hex(emulator.st, 2) << std::endl;
+
+	for (int idx = 0; idx < 16; ++idx) {
+		out << "V" << std::uppercase << std::hex << idx << std::dec << " = ";
+		hex(emulator.v[idx], 2) << std::endl;
+	}
+
+	out << "STACK =";
+	for (int idx = 1; idx <= emulator.sp && idx < Emulator::STACK_SIZE; ++idx) {
+		out << " ";
+		hex(emulator.stack[idx], 4);
+	}
+	out << std::endl;
+
+	out << "CYCLES = " << emulator.cycle_count << std::endl;
+	out << "STATUS = " << status_names[emulator.status] << std::endl;
+}
+
+void write_pbm(std::ostream& out, const bool* display)
+{
+	out << "P1" << std::endl;
+	out << Emulator::DISPLAY_WIDTH << " " << Emulator::DISPLAY_HEIGHT << std::endl;
+
+	for (int y = 0; y < Emulator::DISPLAY_HEIGHT; ++y) {
+		for (int x = 0; x < Emulator::DISPLAY_WIDTH; ++x) {
+			out << (display[x + y * Emulator::DISPLAY_WIDTH] ? '1' : '0');
+		}
+		out << std::endl;
+	}
+}
+
+// Only reads plain PBM images of the display size
+int read_pbm(std::istream& in, bool* display)
+{
+	std::string magic;
+	int width = 0;
+	int height = 0;
+	in >> magic >> width >> height;
+	if (magic != "P1" || width != Emulator::DISPLAY_WIDTH || height != Emulator::DISPLAY_HEIGHT) {
+		return EXIT_FAILURE;
+	}
+
+	for (int pixel = 0; pixel < width * height; ++pixel) {
+		char value;
+		if (!(in >> value) || (value != '0' && value != '1')) {
+			return EXIT_FAILURE;
+		}
+		display[pixel] = value == '1';
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <istream>
+#include <ostream>
+#include "emulator.h"
+
+// Registers, stack and status as one "name = value" line each
+void write_state(std::ostream& out, const Emulator& emulator);
+
+// Display as a plain PBM image, 1 for a lit pixel
+void write_pbm(std::ostream& out, const bool* display);
+int read_pbm(std::istream& in, bool* display);
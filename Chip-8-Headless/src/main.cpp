@@ -0,0 +1,237 @@
+#include "commands.h"
+#include "coverage_recorder.h"
+#include "debugger.h"
+#include "emulator.h"
+#include "machine_dump.h"
+#include "program_analysis.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	void print_usage()
+	{
+		std::cerr << "Usage: Chip-8-Headless run <program> [--frames N | --cycles N] [--backend NAME] [--validate] [--coverage FILE] [--break SPEC] [--watch SPEC] [--state FILE] [--frame FILE]" << std::endl;
+		std::cerr << "       Chip-8-Headless regress <manifest> [--jobs N] [--seed N] [--out DIR]" << std::endl;
+		std::cerr << "       Chip-8-Headless gen <output> [--mix KIND=WEIGHT,...] [--size BYTES] [--seed N] [--loops N] [--depth N]" << std::endl;
+		std::cerr << "       Chip-8-Headless lockstep <manifest> [--a BACKEND] [--b BACKEND] [--interval N] [--jobs N] [--seed N]" << std::endl;
+		std::cerr << "       Chip-8-Headless trace <program> <trace> [--write] [--binary] [--movie FILE] [--sync-random] [--ignore-timers]" << std::endl;
+		std::cerr << "       Chip-8-Headless analyze <program> [--blocks]" << std::endl;
+		std::cerr << "       Chip-8-Headless coverage <manifest> [--jobs N] [--seed N] [--out DIR]" << std::endl;
+		std::cerr << "       Chip-8-Headless profile <program> [--frames N] [--movie FILE] [--seed N] [--cost-model FILE] [--folded FILE] [--top N]" << std::endl;
+		std::cerr << "       Chip-8-Headless netplay <program> --local PORT --remote HOST:PORT [--frames N] [--movie FILE] [--seed N] [--fps N] [--latency MS] [--state FILE]" << std::endl;
+	}
+
+	// Run at full speed without any window, then write the final state and display
+	int run(int argc, char* argv[])
+	{
+		std::string program_path;
+		uint64_t frames = 60;
+		uint64_t cycles = 0;
+		std::string state_path;
+		std::string frame_path;
+		std::string backend_name = "interpreter";
+		bool validate = false;
+		std::string coverage_path;
+		Debugger debugger;
+
+		for (int arg_idx = 0; arg_idx < argc; ++arg_idx) {
+			std::string arg = argv[arg_idx];
+			bool has_value = arg_idx + 1 < argc;
+
+			if (arg == "--frames" && has_value) {
+				frames = std::strtoull(argv[++arg_idx], nullptr, 0);
+				cycles = 0;
+			}
+			else if (arg == "--cycles" && has_value) {
+				cycles = std::strtoull(argv[++arg_idx], nullptr, 0);
+				frames = 0;
+			}
+			else if (arg == "--backend" && has_value) {
+				backend_name = argv[++arg_idx];
+			}
+			else if (arg == "--validate") {
+				validate = true;
+			}
+			else if (arg == "--coverage" && has_value) {
+				coverage_path = argv[++arg_idx];
+			}
+			else if (arg == "--break" && has_value) {
+				if (debugger.add_breakpoint(argv[++arg_idx]) == EXIT_FAILURE) {
+					return EXIT_FAILURE;
+				}
+			}
+			else if (arg == "--watch" && has_value) {
+				if (debugger.add_watchpoint(argv[++arg_idx]) == EXIT_FAILURE) {
+					return EXIT_FAILURE;
+				}
+			}
+			else if (arg == "--state" && has_value) {
+				state_path = argv[++arg_idx];
+			}
+			else if (arg == "--frame" && has_value) {
+				frame_path = argv[++arg_idx];
+			}
+			else if (program_path.empty() && arg.rfind("--", 0) != 0) {
+				program_path = arg;
+			}
+			else {
+				print_usage();
+				return EXIT_FAILURE;
+			}
+		}
+
+		if (program_path.empty()) {
+			print_usage();
+			return EXIT_FAILURE;
+		}
+
+		std::unique_ptr<ExecutionBackend> backend = make_backend(backend_name);
+		if (!backend) {
+			std::cerr << "Unknown execution backend: " << backend_name << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		Emulator emulator;
+		emulator.set_backend(std::move(backend));
+		if (emulator.init(program_path) == EXIT_FAILURE) {
+			std::cerr << "Failed to initialize emulator" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		// Reject programs that would fail once the faulty code is reached, see analyze for the details
+		if (validate) {
+			ProgramAnalysis analysis = analyze_program(emulator.memory);
+			for (const AnalysisIssue& issue : analysis.issues) {
+				if (issue.severity == AnalysisIssue::ERROR) {
+					std::cerr << "Invalid program at #" << std::hex << issue.address << std::dec << ": " << issue.message << std::endl;
+				}
+			}
+			if (analysis.has_errors()) {
+				return EXIT_FAILURE;
+			}
+		}
+
+		CoverageRecorder coverage;
+		ObserverGroup observers;
+		if (!coverage_path.empty()) {
+			observers.add(&coverage);
+		}
+		if (!debugger.empty()) {
+			observers.add(&debugger);
+		}
+		if (!observers.empty()) {
+			emulator.set_observer(&observers);
+		}
+
+		auto start_time = std::chrono::steady_clock::now();
+
+		bool running = true;
+		uint64_t frame_count = 0;
+		try {
+			if (cycles) {
+				// Timers still tick once every CPU_FREQUENCY / TIMER_FREQUENCY cycles
+				while (running && emulator.cycle_count < cycles && !debugger.stopped()) {
+					uint64_t frame_end = (frame_count + 1) * Emulator::CPU_FREQUENCY / Emulator::TIMER_FREQUENCY;
+					running = emulator.run_cycles(std::min(cycles, frame_end) - emulator.cycle_count);
+
+					if (emulator.cycle_count >= frame_end) {
+						emulator.tick_timers();
+						++frame_count;
+					}
+				}
+			}
+			else {
+				// Once idle nothing can change anymore without input, the remaining frames are skipped
+				while (running && frame_count < frames && !emulator.idle() && !debugger.stopped()) {
+					running = emulator.run_frame();
+					++frame_count;
+				}
+			}
+		}
+		catch (const std::exception& exception) {
+			std::cerr << "Emulation stopped at PC = " << emulator.pc << ": " << exception.what() << std::endl;
+			running = false;
+		}
+
+		std::chrono::duration<double> elapsed_time = std::chrono::steady_clock::now() - start_time;
+		std::cout << "Executed " << emulator.cycle_count << " instructions in " << frame_count << " frames, "
+			<< elapsed_time.count() * 1000.0 << " ms ("
+			<< (elapsed_time.count() > 0.0 ? emulator.cycle_count / elapsed_time.count() / 1e6 : 0.0) << " MIPS)" << std::endl;
+		std::cout << "Display hash = " << std::hex << emulator.display_hash() << std::dec << std::endl;
+
+		// The state and frame written below are those of the stop
+		if (debugger.stopped()) {
+			std::cout << "Stopped at #" << std::hex << emulator.pc << std::dec << ": " << debugger.stop_description() << std::endl;
+		}
+
+		if (!coverage_path.empty() && coverage.save(coverage_path) == EXIT_FAILURE) {
+			std::cerr << "Error writing coverage file: " << coverage_path << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		if (!state_path.empty()) {
+			std::ofstream state_file(state_path);
+			write_state(state_file, emulator);
+			if (state_file.fail()) {
+				std::cerr << "Error writing state file: " << state_path << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+
+		if (!frame_path.empty()) {
+			std::ofstream frame_file(frame_path);
+			write_pbm(frame_file, emulator.display);
+			if (frame_file.fail()) {
+				std::cerr << "Error writing frame file: " << frame_path << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+
+		return EXIT_SUCCESS;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (std::strcmp(argv[1], "run") == 0) {
+		return run(argc - 2, argv + 2);
+	}
+	else if (std::strcmp(argv[1], "regress") == 0) {
+		return regress(argc - 2, argv + 2);
+	}
+	else if (std::strcmp(argv[1], "gen") == 0) {
+		return generate(argc - 2, argv + 2);
+	}
+	else if (std::strcmp(argv[1], "lockstep") == 0) {
+		return lockstep(argc - 2, argv + 2);
+	}
+	else if (std::strcmp(argv[1], "trace") == 0) {
+		return trace(argc - 2, argv + 2);
+	}
+	else if (std::strcmp(argv[1], "analyze") == 0) {
+		return analyze(argc - 2, argv + 2);
+	}
+	else if (std::strcmp(argv[1], "coverage") == 0) {
+		return coverage(argc - 2, argv + 2);
+	}
+	else if (std::strcmp(argv[1], "profile") == 0) {
+		return profile(argc - 2, argv + 2);
+	}
+	else if (std::strcmp(argv[1], "netplay") == 0) {
+		return netplay(argc - 2, argv + 2);
+	}
+
+	print_usage();
+	return EXIT_FAILURE;
+}
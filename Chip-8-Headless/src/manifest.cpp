@@ -0,0 +1,59 @@
+#include "manifest.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+int load_manifest(const std::filesystem::path& manifest_path, std::vector<ManifestEntry>& entries)
+{
+	std::ifstream manifest_file(manifest_path);
+	if (manifest_file.fail()) {
+		std::cerr << "Error opening manifest: " << manifest_path.string() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const std::filesystem::path base_path = manifest_path.parent_path();
+
+	std::string line;
+	int line_number = 0;
+	while (std::getline(manifest_file, line)) {
+		++line_number;
+
+		std::istringstream line_stream(line);
+		std::string program;
+		if (!(line_stream >> std::quoted(program)) || program[0] == '#') {
+			continue;
+		}
+
+		ManifestEntry entry;
+		std::string movie;
+		std::string expected_frame;
+		if (!(line_stream >> entry.frames >> std::quoted(movie) >> std::hex >> entry.expected_hash)) {
+			std::cerr << "Invalid manifest entry at " << manifest_path.string() << ":" << line_number << std::endl;
+			return EXIT_FAILURE;
+		}
+		line_stream >> std::quoted(expected_frame);
+
+		// The relative path without extension, directories flattened: programs with the same file name in different
+		// directories do not overwrite each other's output files. The line number tells apart a program listed twice
+		std::filesystem::path name_path = std::filesystem::path(program).replace_extension();
+		entry.name = name_path.lexically_normal().generic_string();
+		std::replace_if(entry.name.begin(), entry.name.end(), [](char c) { return c == '/' || c == ':'; }, '_');
+		if (std::any_of(entries.begin(), entries.end(), [&](const ManifestEntry& other) { return other.name == entry.name; })) {
+			entry.name += "_" + std::to_string(line_number);
+		}
+		entry.program_path = base_path / program;
+		if (movie != "-") {
+			entry.movie_path = base_path / movie;
+		}
+		if (!expected_frame.empty() && expected_frame[0] != '#') {
+			entry.expected_frame_path = base_path / expected_frame;
+		}
+
+		entries.push_back(entry);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Corpus of programs shared by the regression and lockstep runners. One program per line, '#' starts a comment:
+//   <program> <frames> <input movie or -> <expected display hash> [expected frame PBM]
+// Paths are relative to the manifest and may be double quoted. The hash is Emulator::display_hash in hexadecimal.
+struct ManifestEntry
+{
+	std::string name;	// unique within the manifest, also names the files written for the entry
+	std::filesystem::path program_path;
+	uint64_t frames;
+	std::filesystem::path movie_path;
+	uint64_t expected_hash;
+	std::filesystem::path expected_frame_path;
+};
+
+int load_manifest(const std::filesystem::path& manifest_path, std::vector<ManifestEntry>& entries);
@@ -0,0 +1,140 @@
+#include "mapped_file.h"
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+	view(nullptr),
+	view_size(0),
+#if defined(_WIN32)
+	file_handle(INVALID_HANDLE_VALUE),
+	mapping_handle(nullptr)
+#else
+	file_descriptor(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+int MappedFile::open(const std::string& path)
+{
+	close();
+
+#if defined(_WIN32)
+	file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		return EXIT_FAILURE;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size)) {
+		close();
+		return EXIT_FAILURE;
+	}
+	// A 32-bit process cannot address a view of more than SIZE_MAX bytes, the size would be silently truncated
+	if (static_cast<unsigned long long>(file_size.QuadPart) > SIZE_MAX) {
+		std::cerr << "File too large to map in this process: " << path << std::endl;
+		close();
+		return EXIT_FAILURE;
+	}
+	view_size = static_cast<size_t>(file_size.QuadPart);
+
+	// Empty files cannot be mapped, they are just empty
+	if (view_size == 0) {
+		return EXIT_SUCCESS;
+	}
+
+	mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping_handle) {
+		close();
+		return EXIT_FAILURE;
+	}
+
+	view = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+#else
+	file_descriptor = ::open(path.c_str(), O_RDONLY);
+	if (file_descriptor < 0) {
+		return EXIT_FAILURE;
+	}
+
+	struct stat file_status;
+	if (fstat(file_descriptor, &file_status) != 0) {
+		close();
+		return EXIT_FAILURE;
+	}
+	if (static_cast<unsigned long long>(file_status.st_size) > SIZE_MAX) {
+		std::cerr << "File too large to map in this process: " << path << std::endl;
+		close();
+		return EXIT_FAILURE;
+	}
+	view_size = static_cast<size_t>(file_status.st_size);
+
+	if (view_size == 0) {
+		return EXIT_SUCCESS;
+	}
+
+	void* mapping = mmap(nullptr, view_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	if (mapping != MAP_FAILED) {
+		view = static_cast<const uint8_t*>(mapping);
+		madvise(mapping, view_size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (!view) {
+		close();
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+void MappedFile::close()
+{
+#if defined(_WIN32)
+	if (view) {
+		UnmapViewOfFile(view);
+	}
+	if (mapping_handle) {
+		CloseHandle(mapping_handle);
+		mapping_handle = nullptr;
+	}
+	if (file_handle != INVALID_HANDLE_VALUE) {
+		CloseHandle(file_handle);
+		file_handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (view) {
+		munmap(const_cast<uint8_t*>(view), view_size);
+	}
+	if (file_descriptor >= 0) {
+		::close(file_descriptor);
+		file_descriptor = -1;
+	}
+#endif
+
+	view = nullptr;
+	view_size = 0;
+}
+
+const uint8_t* MappedFile::data() const
+{
+	return view;
+}
+
+size_t MappedFile::size() const
+{
+	return view_size;
+}
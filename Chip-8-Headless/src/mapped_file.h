@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file, pages are loaded by the OS on access so huge files cost no RAM upfront
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	int open(const std::string& path);
+	void close();
+
+	const uint8_t* data() const;
+	size_t size() const;
+
+private:
+	const uint8_t* view;
+	size_t view_size;
+#if defined(_WIN32)
+	void* file_handle;
+	void* mapping_handle;
+#else
+	int file_descriptor;
+#endif
+};
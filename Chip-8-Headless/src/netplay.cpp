@@ -0,0 +1,197 @@
+#include "commands.h"
+#include "emulator.h"
+#include "file_utils.h"
+#include "input_movie.h"
+#include "machine_dump.h"
+#include "rollback_session.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// One side of a two-player rollback session, the local keys played from an input movie. Two processes on the same
+// machine exercise the whole protocol over loopback, --latency delays the datagrams sent to get rollbacks:
+//   Chip-8-Headless netplay pong.ch8 --local 7001 --remote 127.0.0.1:7002 --movie left.movie --latency 50
+//   Chip-8-Headless netplay pong.ch8 --local 7002 --remote 127.0.0.1:7001 --movie right.movie --latency 50
+// Both print the same state hash once synchronized.
+namespace
+{
+	const std::chrono::seconds PEER_TIMEOUT(10);
+	const std::chrono::milliseconds LINGER_TIME(250); // the peer may still wait for the last acknowledgment
+
+	// Keys held during each frame, from the movie events of that frame and the previous ones. Like InputMovie::apply, a
+	// key pressed and released in the same frame is held for that frame
+	std::vector<uint16_t> movie_keys(const InputMovie& movie, uint64_t frames)
+	{
+		std::vector<uint16_t> keys(frames);
+		uint16_t mask = 0;
+		size_t event_idx = 0;
+		const std::vector<InputMovie::Event>& events = movie.events();
+		for (uint64_t frame = 0; frame < frames; ++frame) {
+			uint16_t pressed_keys = 0;
+			for (; event_idx < events.size() && events[event_idx].frame <= frame; ++event_idx) {
+				if (events[event_idx].pressed) {
+					mask |= 1 << events[event_idx].key;
+					pressed_keys |= 1 << events[event_idx].key;
+				}
+				else {
+					mask &= ~(1 << events[event_idx].key);
+				}
+			}
+			keys[frame] = mask | pressed_keys;
+		}
+		return keys;
+	}
+}
+
+int netplay(int argc, char* argv[])
+{
+	std::string program_path;
+	int local_port = 0;
+	std::string remote;
+	uint64_t frames = 600;
+	std::string movie_path;
+	uint32_t seed = 0;
+	int fps = Emulator::TIMER_FREQUENCY;
+	int latency_ms = 0;
+	std::string state_path;
+
+	for (int arg_idx = 0; arg_idx < argc; ++arg_idx) {
+		std::string arg = argv[arg_idx];
+		bool has_value = arg_idx + 1 < argc;
+
+		if (arg == "--local" && has_value) {
+			local_port = std::atoi(argv[++arg_idx]);
+		}
+		else if (arg == "--remote" && has_value) {
+			remote = argv[++arg_idx];
+		}
+		else if (arg == "--frames" && has_value) {
+			frames = std::strtoull(argv[++arg_idx], nullptr, 0);
+		}
+		else if (arg == "--movie" && has_value) {
+			movie_path = argv[++arg_idx];
+		}
+		else if (arg == "--seed" && has_value) {
+			seed = static_cast<uint32_t>(std::strtoul(argv[++arg_idx], nullptr, 0));
+		}
+		else if (arg == "--fps" && has_value) {
+			fps = std::atoi(argv[++arg_idx]);
+		}
+		else if (arg == "--latency" && has_value) {
+			latency_ms = std::atoi(argv[++arg_idx]);
+		}
+		else if (arg == "--state" && has_value) {
+			state_path = argv[++arg_idx];
+		}
+		else if (program_path.empty() && arg.rfind("--", 0) != 0) {
+			program_path = arg;
+		}
+		else {
+			program_path.clear();
+			break;
+		}
+	}
+
+	size_t port_separator = remote.rfind(':');
+	if (program_path.empty() || local_port <= 0 || local_port > 0xFFFF || port_separator == std::string::npos) {
+		std::cerr << "Usage: Chip-8-Headless netplay <program> --local PORT --remote HOST:PORT [--frames N] [--movie FILE] [--seed N] [--fps N] [--latency MS] [--state FILE]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::string remote_host = remote.substr(0, port_separator);
+	int remote_port = std::atoi(remote.c_str() + port_separator + 1);
+
+	std::vector<uint8_t> program;
+	if (read_binary_file(program_path, program) == EXIT_FAILURE) {
+		std::cerr << "Error reading program: " << program_path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	InputMovie movie;
+	if (!movie_path.empty() && movie.load(movie_path) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	std::vector<uint16_t> keys = movie_keys(movie, frames);
+
+	// Both sides must start from the same machine, the seed included
+	Emulator emulator;
+	if (emulator.init(program.data(), program.size()) == EXIT_FAILURE) {
+		std::cerr << "Program too large: " << program_path << std::endl;
+		return EXIT_FAILURE;
+	}
+	emulator.seed(seed);
+
+	RollbackSession session(emulator);
+	if (session.open(static_cast<uint16_t>(local_port), remote_host, static_cast<uint16_t>(remote_port)) == EXIT_FAILURE) {
+		std::cerr << "Cannot open UDP port " << local_port << " to " << remote << std::endl;
+		return EXIT_FAILURE;
+	}
+	session.set_send_delay(std::chrono::milliseconds(latency_ms));
+
+	auto frame_duration = fps > 0 ? std::chrono::nanoseconds(1s) / fps : 0ns;
+	auto next_frame_time = std::chrono::steady_clock::now();
+	auto last_progress = next_frame_time;
+
+	try {
+		// A rollback while synchronizing may find the program still running, the frames are then resumed
+		while (true) {
+			bool progressed = false;
+			if (session.frame() < frames && session.running()) {
+				std::this_thread::sleep_until(next_frame_time);
+				progressed = session.advance(keys[session.frame()]);
+				if (progressed) {
+					next_frame_time += frame_duration;
+				}
+			}
+			else if (session.synchronize()) {
+				break;
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			if (progressed) {
+				last_progress = now;
+			}
+			else if (now - last_progress > PEER_TIMEOUT) {
+				std::cerr << "No answer from " << remote << " at frame " << session.frame() << std::endl;
+				return EXIT_FAILURE;
+			}
+			else {
+				std::this_thread::sleep_for(1ms);
+				next_frame_time = std::max(next_frame_time, now);
+			}
+		}
+	}
+	catch (const std::exception& exception) {
+		std::cerr << "Emulation stopped at PC = #" << std::hex << emulator.pc << std::dec << ": " << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	auto linger_end = std::chrono::steady_clock::now() + LINGER_TIME;
+	while (std::chrono::steady_clock::now() < linger_end) {
+		session.synchronize();
+		std::this_thread::sleep_for(1ms);
+	}
+
+	const RollbackSession::Stats& stats = session.stats();
+	std::cout << session.frame() << " frames, " << stats.rollbacks << " rollbacks (" << stats.resimulated_frames << " frames emulated again, deepest "
+		<< stats.max_rollback << "), " << stats.stalls << " stalls, " << stats.packets_sent << " packets sent, " << stats.packets_received << " received" << std::endl;
+	std::cout << "State hash = " << std::hex << emulator.state_hash() << std::endl;
+	std::cout << "Display hash = " << emulator.display_hash() << std::dec << std::endl;
+
+	if (!state_path.empty()) {
+		std::ofstream state_file(state_path);
+		write_state(state_file, emulator);
+		if (state_file.fail()) {
+			std::cerr << "Error writing state file: " << state_path << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Call task(index) for every index in [0, count) on up to jobs threads, 0 means one per hardware thread
+template <typename Task>
+void parallel_for(size_t count, unsigned int jobs, Task task)
+{
+	if (jobs == 0) {
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	}
+	jobs = static_cast<unsigned int>(std::min<size_t>(jobs, count));
+
+	std::atomic<size_t> next_index(0);
+	auto worker = [&]() {
+		for (size_t index = next_index++; index < count; index = next_index++) {
+			task(index);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int thread_idx = 1; thread_idx < jobs; ++thread_idx) {
+		threads.emplace_back(worker);
+	}
+	worker();
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
@@ -0,0 +1,125 @@
+#include "call_profiler.h"
+#include "commands.h"
+#include "emulator.h"
+#include "file_utils.h"
+#include "input_movie.h"
+#include "pc_profiler.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Where the emulated cycles of a program go, by address and by call path, for authors tuning their program against
+// the speed budget
+int profile(int argc, char* argv[])
+{
+	std::string program_path;
+	uint64_t frames = 600;
+	std::string movie_path;
+	uint32_t seed = 0;
+	std::string cost_model_path;
+	size_t top = 30;
+	std::string folded_path;
+
+	for (int arg_idx = 0; arg_idx < argc; ++arg_idx) {
+		std::string arg = argv[arg_idx];
+		bool has_value = arg_idx + 1 < argc;
+
+		if (arg == "--frames" && has_value) {
+			frames = std::strtoull(argv[++arg_idx], nullptr, 0);
+		}
+		else if (arg == "--movie" && has_value) {
+			movie_path = argv[++arg_idx];
+		}
+		else if (arg == "--seed" && has_value) {
+			seed = static_cast<uint32_t>(std::strtoul(argv[++arg_idx], nullptr, 0));
+		}
+		else if (arg == "--cost-model" && has_value) {
+			cost_model_path = argv[++arg_idx];
+		}
+		else if (arg == "--folded" && has_value) {
+			folded_path = argv[++arg_idx];
+		}
+		else if (arg == "--top" && has_value) {
+			top = std::strtoull(argv[++arg_idx], nullptr, 0);
+		}
+		else if (program_path.empty() && arg.rfind("--", 0) != 0) {
+			program_path = arg;
+		}
+		else {
+			program_path.clear();
+			break;
+		}
+	}
+
+	if (program_path.empty()) {
+		std::cerr << "Usage: Chip-8-Headless profile <program> [--frames N] [--movie FILE] [--seed N] [--cost-model FILE] [--folded FILE] [--top N]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<uint8_t> program;
+	if (read_binary_file(program_path, program) == EXIT_FAILURE) {
+		std::cerr << "Error reading program: " << program_path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	InputMovie movie;
+	if (!movie_path.empty() && movie.load(movie_path) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+
+	PcProfiler profiler;
+	CallProfiler call_profiler;
+	if (!cost_model_path.empty()) {
+		std::vector<uint32_t> model;
+		if (load_cost_model(cost_model_path, model) == EXIT_FAILURE) {
+			return EXIT_FAILURE;
+		}
+		profiler.set_cost_model(model);
+		call_profiler.set_cost_model(model);
+	}
+
+	ObserverGroup observers;
+	observers.add(&profiler);
+	observers.add(&call_profiler);
+
+	Emulator emulator;
+	if (emulator.init(program.data(), program.size()) == EXIT_FAILURE) {
+		std::cerr << "Failed to initialize emulator with " << program_path << std::endl;
+		return EXIT_FAILURE;
+	}
+	emulator.seed(seed);
+	emulator.set_observer(&observers);
+
+	uint64_t frame = 0;
+	try {
+		bool running = true;
+		for (; running && frame < frames; ++frame) {
+			movie.apply(emulator, frame);
+			if (emulator.idle() && movie.finished()) {
+				break;
+			}
+			running = emulator.run_frame();
+		}
+	}
+	catch (const std::exception& exception) {
+		std::cerr << "Emulation stopped at PC = " << emulator.pc << ": " << exception.what() << std::endl;
+	}
+
+	std::cout << "Profiled " << frame << " frames: ";
+	profiler.write_report(std::cout, emulator.memory, top);
+	std::cout << std::endl;
+	call_profiler.write_report(std::cout, top);
+
+	if (!folded_path.empty()) {
+		std::ofstream folded_file(folded_path);
+		call_profiler.write_folded(folded_file);
+		if (folded_file.fail()) {
+			std::cerr << "Error writing folded stacks: " << folded_path << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+#include "commands.h"
+#include "emulator.h"
+#include "file_utils.h"
+#include "input_movie.h"
+#include "machine_dump.h"
+#include "manifest.h"
+#include "parallel.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Golden frame regression over a corpus of programs, see manifest.h for the corpus format
+namespace
+{
+	struct RegressionResult
+	{
+		bool passed;
+		uint64_t actual_hash;
+		std::string error;
+		bool display[Emulator::DISPLAY_WIDTH * Emulator::DISPLAY_HEIGHT];
+	};
+
+	void run_case(const ManifestEntry& regression_case, uint32_t seed, RegressionResult& result)
+	{
+		result.passed = false;
+		result.actual_hash = 0;
+
+		std::vector<uint8_t> program;
+		if (read_binary_file(regression_case.program_path.string(), program) == EXIT_FAILURE) {
+			result.error = "cannot read program";
+			return;
+		}
+
+		InputMovie movie;
+		if (!regression_case.movie_path.empty() && movie.load(regression_case.movie_path.string()) == EXIT_FAILURE) {
+			result.error = "cannot read input movie";
+			return;
+		}
+
+		Emulator emulator;
+		if (emulator.init(program.data(), program.size()) == EXIT_FAILURE) {
+			result.error = "program too large";
+			return;
+		}
+		emulator.seed(seed);
+
+		try {
+			bool running = true;
+			for (uint64_t frame = 0; running && frame < regression_case.frames; ++frame) {
+				movie.apply(emulator, frame);
+
+				// Nothing can change anymore, the remaining frames would all be identical
+				if (emulator.idle() && movie.finished()) {
+					break;
+				}
+
+				running = emulator.run_frame();
+			}
+		}
+		catch (const std::exception& exception) {
+			std::ostringstream error;
+			error << "exception at PC = #" << std::hex << emulator.pc << ": " << exception.what();
+			result.error = error.str();
+		}
+
+		std::copy(std::begin(emulator.display), std::end(emulator.display), result.display);
+		result.actual_hash = emulator.display_hash();
+		result.passed = result.error.empty() && result.actual_hash == regression_case.expected_hash;
+	}
+
+	// Write the actual frame, and the pixels differing from the expected frame when there is one
+	std::string write_mismatch(const ManifestEntry& regression_case, const RegressionResult& result, const std::filesystem::path& output_path)
+	{
+		std::filesystem::create_directories(output_path);
+
+		std::filesystem::path actual_path = output_path / (regression_case.name + ".actual.pbm");
+		std::ofstream actual_file(actual_path);
+		write_pbm(actual_file, result.display);
+
+		if (regression_case.expected_frame_path.empty()) {
+			return actual_path.string();
+		}
+
+		bool expected[Emulator::DISPLAY_WIDTH * Emulator::DISPLAY_HEIGHT];
+		std::ifstream expected_file(regression_case.expected_frame_path);
+		if (read_pbm(expected_file, expected) == EXIT_FAILURE) {
+			return actual_path.string() + " (unreadable expected frame)";
+		}
+
+		bool diff[Emulator::DISPLAY_WIDTH * Emulator::DISPLAY_HEIGHT];
+		for (int pixel = 0; pixel < Emulator::DISPLAY_WIDTH * Emulator::DISPLAY_HEIGHT; ++pixel) {
+			diff[pixel] = expected[pixel] != result.display[pixel];
+		}
+
+		std::filesystem::path diff_path = output_path / (regression_case.name + ".diff.pbm");
+		std::ofstream diff_file(diff_path);
+		write_pbm(diff_file, diff);
+
+		return actual_path.string() + ", " + diff_path.string();
+	}
+}
+
+int regress(int argc, char* argv[])
+{
+	std::string manifest_path;
+	unsigned int jobs = 0;
+	uint32_t seed = 0;
+	std::string output_path = "regress_out";
+
+	for (int arg_idx = 0; arg_idx < argc; ++arg_idx) {
+		std::string arg = argv[arg_idx];
+		bool has_value = arg_idx + 1 < argc;
+
+		if (arg == "--jobs" && has_value) {
+			jobs = static_cast<unsigned int>(std::strtoul(argv[++arg_idx], nullptr, 0));
+		}
+		else if (arg == "--seed" && has_value) {
+			seed = static_cast<uint32_t>(std::strtoul(argv[++arg_idx], nullptr, 0));
+		}
+		else if (arg == "--out" && has_value) {
+			output_path = argv[++arg_idx];
+		}
+		else if (manifest_path.empty() && arg.rfind("--", 0) != 0) {
+			manifest_path = arg;
+		}
+		else {
+			manifest_path.clear();
+			break;
+		}
+	}
+
+	if (manifest_path.empty()) {
+		std::cerr << "Usage: Chip-8-Headless regress <manifest> [--jobs N] [--seed N] [--out DIR]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<ManifestEntry> cases;
+	if (load_manifest(manifest_path, cases) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+
+	auto start_time = std::chrono::steady_clock::now();
+
+	std::vector<RegressionResult> results(cases.size());
+	parallel_for(cases.size(), jobs, [&](size_t index) {
+		run_case(cases[index], seed, results[index]);
+	});
+
+	std::chrono::duration<double, std::milli> elapsed_time = std::chrono::steady_clock::now() - start_time;
+
+	int failed = 0;
+	for (size_t index = 0; index < cases.size(); ++index) {
+		const ManifestEntry& regression_case = cases[index];
+		const RegressionResult& result = results[index];
+		if (result.passed) {
+			continue;
+		}
+
+		++failed;
+		std::cout << "FAIL " << regression_case.name << ": ";
+		if (!result.error.empty()) {
+			std::cout << result.error << "; ";
+		}
+		std::cout << std::hex << "expected " << regression_case.expected_hash << ", actual " << result.actual_hash << std::dec
+			<< " (" << write_mismatch(regression_case, result, output_path) << ")" << std::endl;
+	}
+
+	std::cout << (cases.size() - failed) << " passed, " << failed << " failed in " << elapsed_time.count() << " ms" << std::endl;
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
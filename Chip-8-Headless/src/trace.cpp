@@ -0,0 +1,246 @@
+#include "commands.h"
+#include "emulator.h"
+#include "input_movie.h"
+#include "trace_format.h"
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+// Step by step comparison against an instruction trace recorded by another emulator, see trace_format.h.
+// Random numbers and timer ticking legitimately differ between emulators, --sync-random and --ignore-timers cover them.
+namespace
+{
+	struct TraceOptions
+	{
+		std::string program_path;
+		std::string trace_path;
+		std::string movie_path;
+		std::string backend_name;
+		uint64_t cycles;
+		size_t context;
+		uint32_t seed;
+		bool write;
+		bool binary;
+		bool sync_random;
+		bool ignore_timers;
+	};
+
+	std::string compare_records(const TraceRecord& expected, const TraceRecord& actual, bool ignore_timers)
+	{
+		std::ostringstream out;
+		out << std::hex << std::uppercase;
+		auto field = [&out](const std::string& name, int expected_value, int actual_value) {
+			if (expected_value != actual_value) {
+				out << " " << name << " = #" << expected_value << " / #" << actual_value << ";";
+			}
+		};
+
+		field("PC", expected.pc, actual.pc);
+		field("OPCODE", expected.opcode, actual.opcode);
+		if (expected.fields & TraceRecord::HAS_I) {
+			field("I", expected.i, actual.i);
+		}
+		if (expected.fields & TraceRecord::HAS_REGISTERS) {
+			for (int idx = 0; idx < 16; ++idx) {
+				field(std::string("V") + "0123456789ABCDEF"[idx], expected.v[idx], actual.v[idx]);
+			}
+		}
+		if (expected.fields & TraceRecord::HAS_STACK_POINTER) {
+			field("SP", expected.sp, actual.sp);
+		}
+		if ((expected.fields & TraceRecord::HAS_TIMERS) && !ignore_timers) {
+			field("DT", expected.dt, actual.dt);
+			field("ST", expected.st, actual.st);
+		}
+		return out.str();
+	}
+
+	int write_trace(const TraceOptions& options, Emulator& emulator, InputMovie& movie)
+	{
+		std::ofstream trace_file(options.trace_path, std::ios::binary);
+		write_trace_header(trace_file, options.binary);
+
+		bool running = true;
+		uint64_t frame = 0;
+		try {
+			while (running && emulator.cycle_count < options.cycles) {
+				write_trace_record(trace_file, make_trace_record(emulator), options.binary);
+				running = emulator.run_cycles(1);
+
+				if (emulator.cycle_count >= (frame + 1) * Emulator::CPU_FREQUENCY / Emulator::TIMER_FREQUENCY) {
+					emulator.tick_timers();
+					movie.apply(emulator, ++frame);
+				}
+			}
+		}
+		catch (const std::exception& exception) {
+			std::cerr << "Emulation stopped at PC = " << emulator.pc << ": " << exception.what() << std::endl;
+		}
+
+		trace_file.flush();
+		if (trace_file.fail()) {
+			std::cerr << "Error writing trace: " << options.trace_path << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		std::cout << "Wrote " << emulator.cycle_count << " records to " << options.trace_path << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	int compare_trace(const TraceOptions& options, Emulator& emulator, InputMovie& movie)
+	{
+		TraceReader reader;
+		if (reader.open(options.trace_path) == EXIT_FAILURE) {
+			std::cerr << "Error opening trace: " << options.trace_path << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		auto start_time = std::chrono::steady_clock::now();
+
+		// Last records that matched, printed before the divergence
+		std::deque<TraceRecord> context;
+		bool running = true;
+		uint64_t frame = 0;
+		int resync_register = -1;
+		std::string divergence;
+
+		TraceRecord expected;
+		while (reader.next(expected)) {
+			if (resync_register >= 0 && (expected.fields & TraceRecord::HAS_REGISTERS)) {
+				emulator.v[resync_register] = expected.v[resync_register];
+			}
+			resync_register = -1;
+
+			if (!running) {
+				divergence = " program ended before the trace;";
+				break;
+			}
+
+			TraceRecord actual = make_trace_record(emulator);
+			divergence = compare_records(expected, actual, options.ignore_timers);
+			if (!divergence.empty()) {
+				break;
+			}
+
+			context.push_back(actual);
+			if (context.size() > options.context) {
+				context.pop_front();
+			}
+
+			try {
+				running = emulator.run_cycles(1);
+			}
+			catch (const std::exception& exception) {
+				divergence = std::string(" exception: ") + exception.what() + ";";
+				break;
+			}
+
+			if (options.sync_random && (actual.opcode & 0xF000) == 0xC000) {
+				resync_register = (actual.opcode & 0x0F00) >> 8;
+			}
+
+			if (emulator.cycle_count >= (frame + 1) * Emulator::CPU_FREQUENCY / Emulator::TIMER_FREQUENCY) {
+				emulator.tick_timers();
+				movie.apply(emulator, ++frame);
+			}
+		}
+
+		if (!reader.error().empty()) {
+			std::cerr << "Invalid trace at " << options.trace_path << ":" << reader.position() << ": " << reader.error() << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		if (!divergence.empty()) {
+			std::cout << "DIVERGED at step " << emulator.cycle_count << " (" << options.trace_path << ":" << reader.position()
+				<< "), expected / actual:" << divergence << std::endl;
+			for (const TraceRecord& record : context) {
+				std::cout << "  ";
+				write_trace_record(std::cout, record, false);
+			}
+			std::cout << "> ";
+			write_trace_record(std::cout, expected, false);
+			std::cout << std::flush;
+			return EXIT_FAILURE;
+		}
+
+		std::chrono::duration<double> elapsed_time = std::chrono::steady_clock::now() - start_time;
+		std::cout << emulator.cycle_count << " steps match in " << elapsed_time.count() * 1000.0 << " ms" << std::endl;
+		return EXIT_SUCCESS;
+	}
+}
+
+int trace(int argc, char* argv[])
+{
+	TraceOptions options = { "", "", "", "interpreter", 1000000, 8, 0, false, false, false, false };
+	bool valid = true;
+
+	for (int arg_idx = 0; valid && arg_idx < argc; ++arg_idx) {
+		std::string arg = argv[arg_idx];
+		bool has_value = arg_idx + 1 < argc;
+
+		if (arg == "--write") {
+			options.write = true;
+		}
+		else if (arg == "--binary") {
+			options.binary = true;
+		}
+		else if (arg == "--sync-random") {
+			options.sync_random = true;
+		}
+		else if (arg == "--ignore-timers") {
+			options.ignore_timers = true;
+		}
+		else if (arg == "--cycles" && has_value) {
+			options.cycles = std::strtoull(argv[++arg_idx], nullptr, 0);
+		}
+		else if (arg == "--context" && has_value) {
+			options.context = std::strtoull(argv[++arg_idx], nullptr, 0);
+		}
+		else if (arg == "--seed" && has_value) {
+			options.seed = static_cast<uint32_t>(std::strtoul(argv[++arg_idx], nullptr, 0));
+		}
+		else if (arg == "--movie" && has_value) {
+			options.movie_path = argv[++arg_idx];
+		}
+		else if (arg == "--backend" && has_value) {
+			options.backend_name = argv[++arg_idx];
+		}
+		else if (options.program_path.empty() && arg.rfind("--", 0) != 0) {
+			options.program_path = arg;
+		}
+		else if (options.trace_path.empty() && arg.rfind("--", 0) != 0) {
+			options.trace_path = arg;
+		}
+		else {
+			valid = false;
+		}
+	}
+
+	std::unique_ptr<ExecutionBackend> backend = make_backend(options.backend_name);
+	if (!valid || options.trace_path.empty() || !backend) {
+		std::cerr << "Usage: Chip-8-Headless trace <program> <trace> [--movie FILE] [--seed N] [--backend NAME] [--context N] [--sync-random] [--ignore-timers]" << std::endl;
+		std::cerr << "       Chip-8-Headless trace <program> <trace> --write [--binary] [--cycles N] [--movie FILE] [--seed N]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	InputMovie movie;
+	if (!options.movie_path.empty() && movie.load(options.movie_path) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+
+	Emulator emulator;
+	emulator.set_backend(std::move(backend));
+	if (emulator.init(options.program_path) == EXIT_FAILURE) {
+		std::cerr << "Failed to initialize emulator" << std::endl;
+		return EXIT_FAILURE;
+	}
+	emulator.seed(options.seed);
+	movie.apply(emulator, 0);
+
+	return options.write ? write_trace(options, emulator, movie) : compare_trace(options, emulator, movie);
+}
@@ -0,0 +1,217 @@
+#include "trace_format.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+namespace
+{
+	const char TRACE_MAGIC[4] = { 'C', '8', 'T', 'R' };
+	const size_t BINARY_RECORD_SIZE = 26;
+	const int MAX_TEXT_FIELDS = 22;
+
+	int hex_digit(uint8_t c)
+	{
+		if (c >= '0' && c <= '9') {
+			return c - '0';
+		}
+		if (c >= 'a' && c <= 'f') {
+			return c - 'a' + 10;
+		}
+		if (c >= 'A' && c <= 'F') {
+			return c - 'A' + 10;
+		}
+		return -1;
+	}
+}
+
+TraceRecord make_trace_record(const Emulator& emulator)
+{
+	TraceRecord record;
+	record.pc = emulator.pc;
+	record.opcode = emulator.memory[emulator.pc & Emulator::ADDRESS_MASK] << 8 | emulator.memory[(emulator.pc + 1) & Emulator::ADDRESS_MASK];
+	record.i = emulator.i;
+	std::memcpy(record.v, emulator.v, sizeof(record.v));
+	record.sp = emulator.sp;
+	record.dt = emulator.dt;
+	record.st = emulator.st;
+	record.fields = TraceRecord::HAS_I | TraceRecord::HAS_REGISTERS | TraceRecord::HAS_STACK_POINTER | TraceRecord::HAS_TIMERS;
+	return record;
+}
+
+void write_trace_header(std::ostream& out, bool binary)
+{
+	if (binary) {
+		out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	}
+	else {
+		out << "# PC OPCODE I V0 V1 V2 V3 V4 V5 V6 V7 V8 V9 VA VB VC VD VE VF SP DT ST" << std::endl;
+	}
+}
+
+void write_trace_record(std::ostream& out, const TraceRecord& record, bool binary)
+{
+	if (binary) {
+		uint8_t bytes[BINARY_RECORD_SIZE] = {
+			static_cast<uint8_t>(record.pc), static_cast<uint8_t>(record.pc >> 8),
+			static_cast<uint8_t>(record.opcode), static_cast<uint8_t>(record.opcode >> 8),
+			static_cast<uint8_t>(record.i), static_cast<uint8_t>(record.i >> 8),
+		};
+		std::memcpy(bytes + 6, record.v, sizeof(record.v));
+		bytes[22] = record.sp;
+		bytes[23] = record.dt;
+		bytes[24] = record.st;
+		bytes[25] = record.fields;
+		out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+		return;
+	}
+
+	out << std::uppercase << std::hex << std::setfill('0') << std::setw(4) << record.pc << " " << std::setw(4) << record.opcode;
+	if (record.fields & TraceRecord::HAS_I) {
+		out << " " << std::setw(4) << record.i;
+		if (record.fields & TraceRecord::HAS_REGISTERS) {
+			for (uint8_t value : record.v) {
+				out << " " << std::setw(2) << static_cast<int>(value);
+			}
+			if (record.fields & TraceRecord::HAS_STACK_POINTER) {
+				out << " " << std::setw(2) << static_cast<int>(record.sp) << " " << std::setw(2) << static_cast<int>(record.dt)
+					<< " " << std::setw(2) << static_cast<int>(record.st);
+			}
+		}
+	}
+	out << std::dec << "\n"; // no flush, traces are written one record per instruction
+}
+
+TraceReader::TraceReader() :
+	binary(false),
+	offset(0),
+	record_position(0)
+{
+}
+
+int TraceReader::open(const std::string& path)
+{
+	if (file.open(path) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+
+	binary = file.size() >= sizeof(TRACE_MAGIC) && std::memcmp(file.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0;
+	offset = binary ? sizeof(TRACE_MAGIC) : 0;
+	record_position = 0;
+	parse_error.clear();
+	return EXIT_SUCCESS;
+}
+
+bool TraceReader::next(TraceRecord& record)
+{
+	return binary ? next_binary(record) : next_text(record);
+}
+
+const std::string& TraceReader::error() const
+{
+	return parse_error;
+}
+
+uint64_t TraceReader::position() const
+{
+	return record_position;
+}
+
+bool TraceReader::next_binary(TraceRecord& record)
+{
+	if (offset + BINARY_RECORD_SIZE > file.size()) {
+		if (offset != file.size()) {
+			parse_error = "truncated record";
+		}
+		return false;
+	}
+
+	const uint8_t* bytes = file.data() + offset;
+	record.pc = static_cast<uint16_t>(bytes[0] | bytes[1] << 8);
+	record.opcode = static_cast<uint16_t>(bytes[2] | bytes[3] << 8);
+	record.i = static_cast<uint16_t>(bytes[4] | bytes[5] << 8);
+	std::memcpy(record.v, bytes + 6, sizeof(record.v));
+	record.sp = bytes[22];
+	record.dt = bytes[23];
+	record.st = bytes[24];
+	record.fields = bytes[25];
+
+	offset += BINARY_RECORD_SIZE;
+	++record_position;
+	return true;
+}
+
+// Parsed in place from the mapping, a line is never copied
+bool TraceReader::next_text(TraceRecord& record)
+{
+	const uint8_t* data = file.data();
+	const size_t size = file.size();
+
+	while (offset < size) {
+		++record_position;
+
+		uint32_t values[MAX_TEXT_FIELDS];
+		int field_count = 0;
+		bool comment = false;
+		bool valid = true;
+
+		while (offset < size && data[offset] != '\n') {
+			uint8_t c = data[offset];
+			if (c == ' ' || c == '\t' || c == '\r') {
+				++offset;
+			}
+			else if (c == '#' || comment) {
+				comment = true;
+				++offset;
+			}
+			else {
+				uint32_t value = 0;
+				int digit;
+				while (offset < size && (digit = hex_digit(data[offset])) >= 0) {
+					value = (value << 4) | static_cast<uint32_t>(digit);
+					++offset;
+				}
+				if (field_count == MAX_TEXT_FIELDS || (offset < size && data[offset] != ' ' && data[offset] != '\t' && data[offset] != '\r' && data[offset] != '\n')) {
+					valid = false;
+					while (offset < size && data[offset] != '\n') {
+						++offset;
+					}
+					break;
+				}
+				values[field_count++] = value;
+			}
+		}
+		++offset; // newline
+
+		if (field_count == 0 && valid) {
+			continue; // blank or comment line
+		}
+
+		if (!valid || (field_count != 2 && field_count != 3 && field_count != 19 && field_count != 22)) {
+			parse_error = "malformed record";
+			return false;
+		}
+
+		record.pc = static_cast<uint16_t>(values[0]);
+		record.opcode = static_cast<uint16_t>(values[1]);
+		record.fields = 0;
+		if (field_count >= 3) {
+			record.i = static_cast<uint16_t>(values[2]);
+			record.fields |= TraceRecord::HAS_I;
+		}
+		if (field_count >= 19) {
+			for (int idx = 0; idx < 16; ++idx) {
+				record.v[idx] = static_cast<uint8_t>(values[3 + idx]);
+			}
+			record.fields |= TraceRecord::HAS_REGISTERS;
+		}
+		if (field_count == 22) {
+			record.sp = static_cast<uint8_t>(values[19]);
+			record.dt = static_cast<uint8_t>(values[20]);
+			record.st = static_cast<uint8_t>(values[21]);
+			record.fields |= TraceRecord::HAS_STACK_POINTER | TraceRecord::HAS_TIMERS;
+		}
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "emulator.h"
+#include "mapped_file.h"
+
+// Instruction traces, one record per executed instruction holding the state before executing it.
+//
+// Text format, hexadecimal fields separated by spaces, '#' starts a comment line:
+//   PC OPCODE [I [V0 ... VF [SP DT ST]]]
+// so a record has 2, 3, 19 or 22 fields. Other emulators' logs can be converted with a one line script.
+//
+// Binary format, little endian: the magic "C8TR" then 26 byte records
+//   PC (2), OPCODE (2), I (2), V0 ... VF (16), SP (1), DT (1), ST (1), fields (1)
+// where fields tells which of the optional values are valid, see TraceRecord::Field.
+struct TraceRecord
+{
+	enum Field {
+		HAS_I = 1,
+		HAS_REGISTERS = 2,
+		HAS_STACK_POINTER = 4,
+		HAS_TIMERS = 8,
+	};
+
+	uint16_t pc;
+	uint16_t opcode;
+	uint16_t i;
+	uint8_t v[16];
+	uint8_t sp;
+	uint8_t dt;
+	uint8_t st;
+	uint8_t fields;
+};
+
+// Complete record of the emulator state before its next instruction
+TraceRecord make_trace_record(const Emulator& emulator);
+
+void write_trace_record(std::ostream& out, const TraceRecord& record, bool binary);
+void write_trace_header(std::ostream& out, bool binary);
+
+// Streams records out of a memory mapped trace, nothing is loaded upfront
+class TraceReader
+{
+public:
+	TraceReader();
+
+	int open(const std::string& path);
+
+	// false at the end of the trace or on a malformed record, error() tells which
+	bool next(TraceRecord& record);
+	const std::string& error() const;
+
+	// Line number for text traces, record index for binary ones
+	uint64_t position() const;
+
+private:
+	MappedFile file;
+	bool binary;
+	size_t offset;
+	uint64_t record_position;
+	std::string parse_error;
+
+	bool next_binary(TraceRecord& record);
+	bool next_text(TraceRecord& record);
+};